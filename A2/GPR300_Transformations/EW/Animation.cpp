@@ -0,0 +1,199 @@
+#include "Animation.h"
+#include <algorithm>
+#include <math.h>
+#include <immintrin.h>
+
+namespace ew {
+	static const int CHANNEL_COMPONENTS[] = { 3, 4, 3, 1 };
+
+	//Lanes past the track's component count come from the next key's values, so they get masked off
+	static inline __m128 componentMask(int components)
+	{
+		static const __m128 masks[5] = {
+			_mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, 0)),
+			_mm_castsi128_ps(_mm_setr_epi32(-1, 0, 0, 0)),
+			_mm_castsi128_ps(_mm_setr_epi32(-1, -1, 0, 0)),
+			_mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)),
+			_mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, -1))
+		};
+		return masks[components];
+	}
+
+	static inline __m128 dot4(__m128 a, __m128 b)
+	{
+		__m128 product = _mm_mul_ps(a, b);
+		__m128 shuffled = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums = _mm_add_ps(product, shuffled);
+		shuffled = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2));
+		return _mm_add_ps(sums, shuffled);
+	}
+
+	//a + (b - a) * t. For rotations b is flipped onto a's hemisphere first and the result renormalized
+	static inline __m128 interpolate(__m128 a, __m128 b, __m128 t, bool rotation)
+	{
+		if (rotation) {
+			__m128 sign = _mm_and_ps(dot4(a, b), _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)));
+			b = _mm_xor_ps(b, sign);
+		}
+		__m128 result = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+		if (rotation) {
+			result = _mm_div_ps(result, _mm_sqrt_ps(dot4(result, result)));
+		}
+		return result;
+	}
+
+	int AnimationClip::addTrack(AnimationChannel channel, int target)
+	{
+		Track track;
+		track.channel = channel;
+		track.target = target;
+		track.firstKey = (int)mTimes.size();
+		track.numKeys = 0;
+		track.components = CHANNEL_COMPONENTS[(int)channel];
+		//Before the end padding
+		track.firstValue = mValues.empty() ? 0 : (int)mValues.size() - 3;
+		mTracks.push_back(track);
+		return (int)mTracks.size() - 1;
+	}
+
+	void AnimationClip::addKey(int track, float time, const float* value)
+	{
+		//Each track's keys stay contiguous, so keys added to an earlier track push the later tracks along
+		Track& t = mTracks[track];
+		if (mValues.empty()) {
+			mValues.resize(3, 0.0f);
+		}
+		mTimes.insert(mTimes.begin() + t.firstKey + t.numKeys, time);
+		mValues.insert(mValues.begin() + t.firstValue + t.numKeys * t.components, value, value + t.components);
+		t.numKeys++;
+		for (size_t i = track + 1; i < mTracks.size(); i++) {
+			mTracks[i].firstKey++;
+			mTracks[i].firstValue += t.components;
+		}
+		mDuration = std::max(mDuration, time);
+	}
+
+	void AnimationClip::addKey(int track, float time, const glm::vec3& value)
+	{
+		addKey(track, time, &value.x);
+	}
+
+	void AnimationClip::addKey(int track, float time, const glm::quat& rotation)
+	{
+		float value[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+		addKey(track, time, value);
+	}
+
+	void AnimationClip::addKey(int track, float time, float value)
+	{
+		addKey(track, time, &value);
+	}
+
+	float AnimationClip::wrapTime(float time)const
+	{
+		if (mDuration <= 0.0f) {
+			return 0.0f;
+		}
+		if (mLooping) {
+			time = fmodf(time, mDuration);
+			return time < 0.0f ? time + mDuration : time;
+		}
+		return std::min(std::max(time, 0.0f), mDuration);
+	}
+
+	//Index of the last key at or before time. Checks the cached key and the next couple first, since playback
+	//mostly moves forward by less than a key per frame, and only binary searches on a jump
+	int AnimationClip::findKey(const Track& track, float time, int cursor)const
+	{
+		const float* times = &mTimes[track.firstKey];
+		int lastKey = track.numKeys - 1;
+		if (cursor >= 0 && cursor <= lastKey && times[cursor] <= time)
+		{
+			for (int i = 0; i < 3 && cursor < lastKey; i++, cursor++) {
+				if (time < times[cursor + 1]) {
+					return cursor;
+				}
+			}
+			if (cursor == lastKey) {
+				return cursor;
+			}
+		}
+		int key = (int)(std::upper_bound(times, times + track.numKeys, time) - times) - 1;
+		return std::max(key, 0);
+	}
+
+	glm::vec4 AnimationClip::sampleTrack(const Track& track, float time, int& cursor)const
+	{
+		glm::vec4 out(0.0f);
+		if (track.numKeys == 0) {
+			return out;
+		}
+		cursor = findKey(track, time, cursor);
+		const float* a = &mValues[track.firstValue + cursor * track.components];
+		__m128 mask = componentMask(track.components);
+		__m128 result;
+		if (cursor + 1 >= track.numKeys) {
+			result = _mm_and_ps(_mm_loadu_ps(a), mask);
+		}
+		else {
+			const float* times = &mTimes[track.firstKey];
+			float t = (time - times[cursor]) / (times[cursor + 1] - times[cursor]);
+			t = std::min(std::max(t, 0.0f), 1.0f);
+			__m128 va = _mm_and_ps(_mm_loadu_ps(a), mask);
+			__m128 vb = _mm_and_ps(_mm_loadu_ps(a + track.components), mask);
+			result = interpolate(va, vb, _mm_set1_ps(t), track.channel == AnimationChannel::Rotation);
+		}
+		_mm_storeu_ps(&out.x, result);
+		return out;
+	}
+
+	void AnimationClip::sample(float time, std::vector<int>& cursors, glm::vec4* outPose)const
+	{
+		time = wrapTime(time);
+		cursors.resize(mTracks.size(), 0);
+		for (size_t i = 0; i < mTracks.size(); i++) {
+			outPose[i] = sampleTrack(mTracks[i], time, cursors[i]);
+		}
+	}
+
+	glm::vec4 AnimationClip::sampleTrack(int track, float time)const
+	{
+		int cursor = -1;
+		return sampleTrack(mTracks[track], wrapTime(time), cursor);
+	}
+
+	AnimationPlayer::AnimationPlayer(const AnimationClip* clip)
+		: mClip(clip), mCursors(clip->getTrackCount(), 0), mPose(clip->getTrackCount())
+	{
+	}
+
+	void AnimationPlayer::advance(float deltaTime)
+	{
+		mTime += deltaTime * mSpeed;
+		//Keep the time small so float precision doesn't run out over long sessions
+		if (mClip->isLooping() && mClip->getDuration() > 0.0f) {
+			mTime = fmodf(mTime, mClip->getDuration());
+		}
+	}
+
+	void AnimationPlayer::setTime(float time)
+	{
+		mTime = time;
+	}
+
+	const std::vector<glm::vec4>& AnimationPlayer::sample()
+	{
+		mPose.resize(mClip->getTrackCount());
+		mClip->sample(mTime, mCursors, mPose.data());
+		return mPose;
+	}
+
+	void blendPoses(const AnimationClip& layout, const glm::vec4* a, const glm::vec4* b, float weight, glm::vec4* out)
+	{
+		__m128 t = _mm_set1_ps(weight);
+		for (int i = 0; i < layout.getTrackCount(); i++) {
+			__m128 result = interpolate(_mm_loadu_ps(&a[i].x), _mm_loadu_ps(&b[i].x), t, layout.getChannel(i) == AnimationChannel::Rotation);
+			_mm_storeu_ps(&out[i].x, result);
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+namespace ew {
+	//What a track animates. Rotation keys are quaternions and are interpolated along the shortest arc
+	enum class AnimationChannel {
+		Position,
+		Rotation,
+		Scale,
+		Float
+	};
+
+	/// <summary>
+	/// Keyframe tracks sharing one time line. All keys of all tracks live in two flat arrays, and every track
+	/// samples to a vec4 (xyz for position/scale, xyzw quaternion for rotation, x for floats), so sampling is one SSE
+	/// lerp per track. Keys of a track have to be added in increasing time order
+	/// </summary>
+	class AnimationClip {
+	public:
+		//target is whatever the caller wants the track to drive: a cube index, a scene graph node...
+		int addTrack(AnimationChannel channel, int target);
+		void addKey(int track, float time, const glm::vec3& value);
+		void addKey(int track, float time, const glm::quat& rotation);
+		void addKey(int track, float time, float value);
+		inline void setLooping(bool looping) { mLooping = looping; }
+		inline bool isLooping()const { return mLooping; }
+		inline float getDuration()const { return mDuration; }
+		inline int getTrackCount()const { return (int)mTracks.size(); }
+		inline AnimationChannel getChannel(int track)const { return mTracks[track].channel; }
+		inline int getTarget(int track)const { return mTracks[track].target; }
+
+		//Samples every track at time (wrapped or clamped to the clip) into outPose[track].
+		//cursors holds one key index per track, kept between calls so playing forward finds keys without searching
+		void sample(float time, std::vector<int>& cursors, glm::vec4* outPose)const;
+		//Single track, for debugging and tests
+		glm::vec4 sampleTrack(int track, float time)const;
+	private:
+		struct Track {
+			AnimationChannel channel;
+			int target;
+			int firstKey;
+			int numKeys;
+			int components;
+			int firstValue;
+		};
+		void addKey(int track, float time, const float* value);
+		float wrapTime(float time)const;
+		int findKey(const Track& track, float time, int cursor)const;
+		glm::vec4 sampleTrack(const Track& track, float time, int& cursor)const;
+
+		std::vector<Track> mTracks;
+		std::vector<float> mTimes;
+		//Padded with 3 floats at the end so 4 wide loads of the last key stay in bounds
+		std::vector<float> mValues;
+		float mDuration = 0.0f;
+		bool mLooping = true;
+	};
+
+	/// <summary>
+	/// Plays one clip: keeps the time and the per track cursors, and owns the sampled pose
+	/// </summary>
+	class AnimationPlayer {
+	public:
+		AnimationPlayer(const AnimationClip* clip);
+		void advance(float deltaTime);
+		void setTime(float time);
+		inline float getTime()const { return mTime; }
+		inline float getSpeed()const { return mSpeed; }
+		inline void setSpeed(float speed) { mSpeed = speed; }
+		//Samples the clip at the current time
+		const std::vector<glm::vec4>& sample();
+		inline const std::vector<glm::vec4>& getPose()const { return mPose; }
+		inline const AnimationClip* getClip()const { return mClip; }
+	private:
+		const AnimationClip* mClip;
+		float mTime = 0.0f;
+		float mSpeed = 1.0f;
+		std::vector<int> mCursors;
+		std::vector<glm::vec4> mPose;
+	};
+
+	//Blends two poses sampled from clips with the same track layout (as layout). weight 0 is all a, 1 is all b.
+	//Rotations are nlerped along the shortest arc. out may alias a or b
+	void blendPoses(const AnimationClip& layout, const glm::vec4* a, const glm::vec4* b, float weight, glm::vec4* out);
+}
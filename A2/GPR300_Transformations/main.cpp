@@ -17,6 +17,7 @@
 
 #include "EW/Shader.h"
 #include "EW/ShapeGen.h"
+#include "EW/Animation.h"
 #include <iostream>
 
 void resizeFrameBufferCallback(GLFWwindow* window, int width, int height);
@@ -119,8 +120,6 @@ struct Transform
 	glm::vec3 position;
 	glm::vec3 rotation;
 	glm::vec3 scale;
-	//IMPORTANT: this is just here for my cool little system to be shown off. It obviously doesnt hold any vital infomration.
-	bool increasing = true;
 
 	glm::mat4 getModelMatrix()
 	{
@@ -226,6 +225,20 @@ int main() {
 		cubeTransforms[i].scale = glm::vec3(0.2f, 1, 1);
 	}
 
+	//Bars grow to 6, shrink to 0.8 and repeat, at the speeds the old per frame steps (+0.05, -0.07) had at 60 fps
+	const float BAR_GROW_SPEED = 0.05f * 60.0f;
+	const float BAR_SHRINK_SPEED = 0.07f * 60.0f;
+	ew::AnimationClip barClip;
+	int barTrack = barClip.addTrack(ew::AnimationChannel::Scale, 0);
+	barClip.addKey(barTrack, 0.0f, glm::vec3(0.2f, 0.8f, 1.0f));
+	barClip.addKey(barTrack, 5.2f / BAR_GROW_SPEED, glm::vec3(0.2f, 6.0f, 1.0f));
+	barClip.addKey(barTrack, 5.2f / BAR_GROW_SPEED + 5.2f / BAR_SHRINK_SPEED, glm::vec3(0.2f, 0.8f, 1.0f));
+	//Each bar starts a little after the last one, from its starting height of 1
+	std::vector<ew::AnimationPlayer> barPlayers(CUBE_AMOUNT, ew::AnimationPlayer(&barClip));
+	for (ew::AnimationPlayer& player : barPlayers) {
+		player.setTime(0.2f / BAR_GROW_SPEED);
+	}
+
 	while (!glfwWindowShouldClose(window)) {
 		glClearColor(bgColor.r,bgColor.g,bgColor.b, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -234,6 +247,8 @@ int main() {
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 		float time = (float)glfwGetTime();
+		deltaTime = time - lastFrameTime;
+		lastFrameTime = time;
 		camera.position.z = sin(time * camera.cameraSpeed) * camera.cameraRadius;
 		camera.position.x = cos(time * camera.cameraSpeed) * camera.cameraRadius;
 		glm::mat4 projection;
@@ -255,30 +270,13 @@ int main() {
 
 			if (i * 0.1f < time)
 			{
-				if (cubeTransforms[i].scale.y >= 6)
-				{
-					cubeTransforms[i].increasing = false;
-				}
-				if (cubeTransforms[i].scale.y <= 0.8f)
-				{
-					cubeTransforms[i].increasing = true;
-				}
-				if (cubeTransforms[i].increasing)
-				{
-					cubeTransforms[i].scale.y += 0.05f;
-				}
-				else
-				{
-					cubeTransforms[i].scale.y -= 0.07f;
-				}
+				barPlayers[i].advance(deltaTime);
+				cubeTransforms[i].scale = glm::vec3(barPlayers[i].sample()[barTrack]);
 			}
 			shader.setMat4("model", cubeTransforms[i].getModelMatrix());
 			shader.setFloat("yScale", cubeTransforms[i].scale.y);
 			cubeMesh.draw();
 		}
-		deltaTime = time - lastFrameTime;
-		lastFrameTime = time;
-
 		//Draw
 		//Draw UI
 		ImGui::Begin("Settings");
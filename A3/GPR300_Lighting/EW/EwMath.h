@@ -3,9 +3,10 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <math.h>
 
 namespace ew {
-	glm::mat4 translate(const glm::vec3& t) {
+	inline glm::mat4 translate(const glm::vec3& t) {
 		return glm::mat4{
 			1.0, 0.0, 0.0, 0.0,
 			0.0, 1.0, 0.0, 0.0,
@@ -14,7 +15,7 @@ namespace ew {
 		};
 	}
 
-	glm::mat4 rotateX(float a) {
+	inline glm::mat4 rotateX(float a) {
 		return glm::mat4{
 			1.0,  0.0, 0.0, 0.0,
 			0.0, cos(a), sin(a), 0.0,
@@ -23,7 +24,7 @@ namespace ew {
 		};
 	}
 
-	glm::mat4 rotateY(float a) {
+	inline glm::mat4 rotateY(float a) {
 		return glm::mat4{
 			cos(a),  0.0, sin(a), 0.0,
 			0.0,     1.0, 0.0,    0.0,
@@ -32,7 +33,7 @@ namespace ew {
 		};
 	}
 
-	glm::mat4 rotateZ(float a) {
+	inline glm::mat4 rotateZ(float a) {
 		return glm::mat4{
 			cos(a),  sin(a), 0.0, 0.0,
 			-sin(a), cos(a), 0.0, 0.0,
@@ -41,7 +42,7 @@ namespace ew {
 		};
 	}
 
-	glm::mat4 scale(const glm::vec3& s) {
+	inline glm::mat4 scale(const glm::vec3& s) {
 		return glm::mat4{
 			s.x, 0.0, 0.0, 0.0,
 			0.0, s.y, 0.0, 0.0,
@@ -49,4 +50,45 @@ namespace ew {
 			0.0, 0.0, 0.0, 1.0
 		};
 	}
+
+	/// <summary>
+	/// Same matrix as translate(t) * rotateX(r.x) * rotateY(r.y) * rotateZ(r.z) * scale(s), written out directly.
+	/// One sin and cos per axis and no matrix multiplies
+	/// </summary>
+	inline glm::mat4 composeTRS(const glm::vec3& t, const glm::vec3& r, const glm::vec3& s) {
+		float sx = sinf(r.x), cx = cosf(r.x);
+		float sy = sinf(r.y), cy = cosf(r.y);
+		float sz = sinf(r.z), cz = cosf(r.z);
+		return glm::mat4{
+			cy * cz * s.x, (cx * sz - sx * sy * cz) * s.x, (sx * sz + cx * sy * cz) * s.x, 0.0,
+			-cy * sz * s.y, (cx * cz + sx * sy * sz) * s.y, (sx * cz - cx * sy * sz) * s.y, 0.0,
+			-sy * s.z, -sx * cy * s.z, cx * cy * s.z, 0.0,
+			t.x, t.y, t.z, 1.0
+		};
+	}
+
+	/// <summary>
+	/// Normal matrix (inverse transpose of the upper 3x3) for composeTRS(t, r, s). The rotation is orthonormal,
+	/// so this is just the rotation columns divided by the scale instead of multiplied
+	/// </summary>
+	inline glm::mat3 composeNormalMatrix(const glm::vec3& r, const glm::vec3& s) {
+		float sx = sinf(r.x), cx = cosf(r.x);
+		float sy = sinf(r.y), cy = cosf(r.y);
+		float sz = sinf(r.z), cz = cosf(r.z);
+		return glm::mat3{
+			cy * cz / s.x, (cx * sz - sx * sy * cz) / s.x, (sx * sz + cx * sy * cz) / s.x,
+			-cy * sz / s.y, (cx * cz + sx * sy * sz) / s.y, (sx * cz - cx * sy * sz) / s.y,
+			-sy / s.z, -sx * cy / s.z, cx * cy / s.z
+		};
+	}
+
+	/// <summary>
+	/// Normal matrix of any affine matrix. The inverse transpose of [a b c] is [b x c, c x a, a x b] / det
+	/// </summary>
+	inline glm::mat3 normalMatrix(const glm::mat4& m) {
+		glm::vec3 a = glm::vec3(m[0]), b = glm::vec3(m[1]), c = glm::vec3(m[2]);
+		glm::vec3 bc = glm::cross(b, c);
+		float inverseDeterminant = 1.0f / glm::dot(a, bc);
+		return glm::mat3(bc, glm::cross(c, a), glm::cross(a, b)) * inverseDeterminant;
+	}
 }
@@ -4,6 +4,7 @@ layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vUV;
 
 uniform mat4 _Model;
+uniform mat3 _NormalMatrix;
 uniform mat4 _View;
 uniform mat4 _Projection;
 uniform vec3 _LightPos;
@@ -17,7 +18,7 @@ out vec2 uv;
 
 void main(){    
     WorldPos = vec3(_Model * vec4(vPos, 1));
-    WorldNormal = mat3(transpose(inverse(_Model))) * vNormal;
+    WorldNormal = _NormalMatrix * vNormal;
     uv = vUV; 
     gl_Position = _Projection * _View * _Model * vec4(vPos,1);
 }
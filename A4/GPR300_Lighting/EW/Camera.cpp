@@ -2,33 +2,97 @@
 
 #include "Camera.h"
 
-glm::vec3 Camera::getForward() {
-	float yawRad = glm::radians(mYaw);
-	float pitchRad = glm::radians(mPitch);
-
-	glm::vec3 forward;
-	forward.x = cos(yawRad) * cos(pitchRad);
-	forward.y = sin(pitchRad);
-	forward.z = sin(yawRad) * cos(pitchRad);
-	return forward;
-}
-
-glm::mat4 Camera::getProjectionMatrix() {
-	if (mOrtho) {
-		float width = mOrthoSize * mAspectRatio;
-		float right = width * 0.5f;
-		float left = -right;
-		float top = mOrthoSize * 0.5f;
-		float bottom = -top;
-		return glm::ortho(left,right,bottom,top, mNearPlane, mFarPlane);
+FrustumPlanes extractFrustumPlanes(const glm::mat4& viewProjection) {
+	//Gribb/Hartmann: each plane is the w row plus or minus one of the others
+	glm::mat4 rows = glm::transpose(viewProjection);
+	glm::vec4 planes[FrustumPlanes::NUM_PLANES] = {
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+	FrustumPlanes frustum;
+	for (int i = 0; i < 8; i++) {
+		glm::vec4 plane = planes[i % FrustumPlanes::NUM_PLANES];
+		plane /= glm::length(glm::vec3(plane));
+		frustum.normalX[i] = plane.x;
+		frustum.normalY[i] = plane.y;
+		frustum.normalZ[i] = plane.z;
+		frustum.distance[i] = plane.w;
 	}
-	else {
-		return glm::perspective(glm::radians(mFov), mAspectRatio, mNearPlane, mFarPlane);
+	return frustum;
+}
+
+void Camera::updateMatrices()const {
+	if (!mViewDirty && !mProjectionDirty) {
+		return;
+	}
+	if (mViewDirty) {
+		float yawRad = glm::radians(mYaw);
+		float pitchRad = glm::radians(mPitch);
+		mForward.x = cos(yawRad) * cos(pitchRad);
+		mForward.y = sin(pitchRad);
+		mForward.z = sin(yawRad) * cos(pitchRad);
+		mView = glm::lookAt(mPosition, mPosition + mForward, glm::vec3(0, 1, 0));
+		mInverseView = glm::inverse(mView);
 	}
+	if (mProjectionDirty) {
+		if (mOrtho) {
+			float width = mOrthoSize * mAspectRatio;
+			float right = width * 0.5f;
+			float left = -right;
+			float top = mOrthoSize * 0.5f;
+			float bottom = -top;
+			mProjection = glm::ortho(left, right, bottom, top, mNearPlane, mFarPlane);
+		}
+		else {
+			mProjection = glm::perspective(glm::radians(mFov), mAspectRatio, mNearPlane, mFarPlane);
+		}
+		mInverseProjection = glm::inverse(mProjection);
+	}
+	mViewProjection = mProjection * mView;
+	mInverseViewProjection = mInverseView * mInverseProjection;
+	mFrustumPlanes = extractFrustumPlanes(mViewProjection);
+	mViewDirty = false;
+	mProjectionDirty = false;
 }
 
-glm::mat4 Camera::getViewMatrix() {
-	return glm::lookAt(mPosition, mPosition + getForward(), glm::vec3(0,1,0));
+const glm::vec3& Camera::getForward()const {
+	updateMatrices();
+	return mForward;
 }
 
+const glm::mat4& Camera::getProjectionMatrix()const {
+	updateMatrices();
+	return mProjection;
+}
+
+const glm::mat4& Camera::getViewMatrix()const {
+	updateMatrices();
+	return mView;
+}
+
+const glm::mat4& Camera::getViewProjectionMatrix()const {
+	updateMatrices();
+	return mViewProjection;
+}
+
+const glm::mat4& Camera::getInverseProjectionMatrix()const {
+	updateMatrices();
+	return mInverseProjection;
+}
+
+const glm::mat4& Camera::getInverseViewMatrix()const {
+	updateMatrices();
+	return mInverseView;
+}
+
+const glm::mat4& Camera::getInverseViewProjectionMatrix()const {
+	updateMatrices();
+	return mInverseViewProjection;
+}
+
+const FrustumPlanes& Camera::getFrustumPlanes()const {
+	updateMatrices();
+	return mFrustumPlanes;
+}
 
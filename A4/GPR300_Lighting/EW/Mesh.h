@@ -10,9 +10,11 @@ namespace ew {
 		glm::vec3 position;
 		glm::vec3 normal;
 		glm::vec2 UV;
-		glm::vec3 tangent;
-		Vertex(glm::vec3 position, glm::vec3 normal, glm::vec2 UV, glm::vec3 tangent)
-			: position(position), normal(normal), UV(UV), tangent(tangent) {};
+		glm::vec4 tangent; //w is the bitangent sign, bitangent = cross(normal, tangent.xyz) * w
+		Vertex() {};
+		//Leave tangent out to have generateTangents fill it in from the UVs
+		Vertex(glm::vec3 position, glm::vec3 normal, glm::vec2 UV, glm::vec3 tangent = glm::vec3(0), float bitangentSign = 1.0f)
+			: position(position), normal(normal), UV(UV), tangent(tangent, bitangentSign) {};
 	};
 
 	/// <summary>
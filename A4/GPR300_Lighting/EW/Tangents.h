@@ -0,0 +1,11 @@
+#pragma once
+#include "Mesh.h"
+
+namespace ew {
+	/// <summary>
+	/// Fills in vertex tangents (w = bitangent sign) from positions, normals and UVs.
+	/// Follows MikkTSpace's per vertex rules: triangle tangents are projected onto the vertex normal,
+	/// weighted by corner angle, then orthonormalized. Vertices are never split.
+	/// </summary>
+	void generateTangents(MeshData& meshData);
+}
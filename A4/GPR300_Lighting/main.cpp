@@ -68,6 +68,8 @@ struct PointLight
 	glm::vec3 color = glm::vec3(1);
 	glm::vec3 position = glm::vec3(0);
 	float attenuation = 1;
+	//Past this distance the light adds nothing
+	float range = 10;
 	float intensity = 1.0f;
 };
 struct SpotLight
@@ -76,6 +78,8 @@ struct SpotLight
 	glm::vec3 position = glm::vec3(0, 2, 0);
 	glm::vec3 direction = glm::vec3(0, -1, 0);;
 	float attenuation = 1;
+	//Past this distance the light adds nothing
+	float range = 10;
 	float intensity = 1.0f;
 	float minAngle = 80;
 	float maxAngle = 140;
@@ -269,11 +273,13 @@ int main() {
 		litShader.setVec3("_PointLights[0].color", pointLight1.color);
 		litShader.setFloat("_PointLights[0].intensity", pointLight1.intensity);
 		litShader.setFloat("_PointLights[0].attenuation", pointLight1.attenuation);
+		litShader.setFloat("_PointLights[0].range", pointLight1.range);
 
 		litShader.setVec3("_PointLights[1].position", pointLight2.position);
 		litShader.setVec3("_PointLights[1].color", pointLight2.color);
 		litShader.setFloat("_PointLights[1].intensity", pointLight2.intensity);
 		litShader.setFloat("_PointLights[1].attenuation", pointLight2.attenuation);
+		litShader.setFloat("_PointLights[1].range", pointLight2.range);
 
 		//spot light
 		litShader.setVec3("_SpotLight.position", spotlight.position);
@@ -281,6 +287,7 @@ int main() {
 		litShader.setVec3("_SpotLight.color", spotlight.color);
 		litShader.setFloat("_SpotLight.intensity", spotlight.intensity);
 		litShader.setFloat("_SpotLight.attenuation", spotlight.attenuation);
+		litShader.setFloat("_SpotLight.range", spotlight.range);
 		litShader.setFloat("_SpotLight.minAngle", spotlight.minAngle);
 		litShader.setFloat("_SpotLight.maxAngle", spotlight.maxAngle);
 
@@ -305,18 +312,22 @@ int main() {
 
 		//Draw cube
 		litShader.setMat4("_Model", cubeTransform.getModelMatrix());
+		litShader.setMat3("_NormalMatrix", cubeTransform.getNormalMatrix());
 		cubeMesh.draw();
 
 		//Draw sphere
 		litShader.setMat4("_Model", sphereTransform.getModelMatrix());
+		litShader.setMat3("_NormalMatrix", sphereTransform.getNormalMatrix());
 		sphereMesh.draw();
 
 		//Draw cylinder
 		litShader.setMat4("_Model", cylinderTransform.getModelMatrix());
+		litShader.setMat3("_NormalMatrix", cylinderTransform.getNormalMatrix());
 		cylinderMesh.draw();
 
 		//Draw plane
 		litShader.setMat4("_Model", planeTransform.getModelMatrix());
+		litShader.setMat3("_NormalMatrix", planeTransform.getNormalMatrix());
 		planeMesh.draw();
 
 		unlitShader.use();
@@ -352,11 +363,13 @@ int main() {
 		ImGui::Begin("Point Settings");
 		ImGui::SliderFloat("Point Light 1 Intensity", &pointLight1.intensity, 0, 5);
 		ImGui::SliderFloat("Point Light 1 Atten.", &pointLight1.attenuation, 0, 5);
+		ImGui::SliderFloat("Point Light 1 Range", &pointLight1.range, 0.1f, 50);
 		ImGui::ColorEdit3("Point Light 1 Color", &pointLight1.color.r);
 		ImGui::DragFloat3("Point Light 1 Position", &pointLight1.position.x);
 
 		ImGui::SliderFloat("Point Light 2 Intensity", &pointLight2.intensity, 0, 5);
 		ImGui::SliderFloat("Point Light 2 Atten.", &pointLight2.attenuation, 0, 5);
+		ImGui::SliderFloat("Point Light 2 Range", &pointLight2.range, 0.1f, 50);
 		ImGui::ColorEdit3("Point Light 2 Color", &pointLight2.color.r);
 		ImGui::DragFloat3("Point Light 2 Position", &pointLight2.position.x);
 		ImGui::End();
@@ -22,6 +22,7 @@ struct PointLight
     vec3 color;
     float intensity;
     float attenuation;
+    float range;
 };
 
 struct DirectionalLight
@@ -38,6 +39,7 @@ struct SpotLight
     vec3 direction;
     float intensity;
     float attenuation;
+    float range;
     float minAngle;
     float maxAngle;
 };
@@ -59,6 +61,14 @@ uniform SpotLight _SpotLight;
 uniform Material _Material;
 uniform float _NormalStrength;
 
+//Inverse square past attenuation, windowed to reach 0 at range so a light never touches anything farther away
+float localLightFalloff(float dist, float attenuation, float range)
+{
+    float ratio = dist / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window * pow(attenuation / max(attenuation, dist), 2);
+}
+
 vec3 calculateDirectionalLight(DirectionalLight light, vec3 norm)
 {
     vec3 result = vec3(0);
@@ -87,7 +97,7 @@ vec3 calculateSpotLight(SpotLight light, vec3 norm)
     float intensity = light.intensity * i;
     vec3 viewDir = normalize(_ViewPos - WorldPos);
     vec3 halfway = normalize(lightDir + viewDir);
-    float attenuation = pow((light.attenuation / max(light.attenuation, distance(WorldPos, light.position))), 2);
+    float attenuation = localLightFalloff(distance(WorldPos, light.position), light.attenuation, light.range);
     float diff = _Material.diffuseK * max(dot(normal, lightDir), 0.0);
     float spec = _Material.specularK * pow(max(dot(normal, halfway), 0.0), _Material.shininess);
     vec3 diffuse = diff * light.color * intensity * attenuation;
@@ -104,7 +114,7 @@ vec3 calculatePointLight(PointLight light, vec3 norm)
     vec3 lightDir = normalize(light.position - WorldPos);
     vec3 viewDir = normalize(_ViewPos - WorldPos);
     vec3 halfway = normalize(lightDir + viewDir);
-    float attenuation = pow((light.attenuation / max(light.attenuation, distance(WorldPos, light.position))), 2);
+    float attenuation = localLightFalloff(distance(WorldPos, light.position), light.attenuation, light.range);
     float diff = _Material.diffuseK * max(dot(normal, lightDir), 0.0);
     float spec = _Material.specularK * pow(max(dot(normal, halfway), 0.0), _Material.shininess);
     vec3 diffuse = diff * light.color * light.intensity * attenuation;
@@ -119,7 +129,7 @@ void main()
     vec3 result = vec3(0);
     vec3 norm = (texture(_Texture1Normal, uv).rgb * 2) - 1;
     norm *= vec3(_NormalStrength, _NormalStrength, 1);
-    norm *= tangent;
+    norm = normalize(tangent * norm);
     result += calculateDirectionalLight(_DirectionalLight, norm);
     for(int i = 0; i < MAX_LIGHTS; i++)
     {
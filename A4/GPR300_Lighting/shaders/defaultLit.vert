@@ -2,9 +2,10 @@
 layout (location = 0) in vec3 vPos;  
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vUV;
-layout (location = 3) in vec3 vTan;
+layout (location = 3) in vec4 vTan;
 
 uniform mat4 _Model;
+uniform mat3 _NormalMatrix;
 uniform mat4 _View;
 uniform mat4 _Projection;
 uniform vec3 _LightPos;
@@ -19,9 +20,14 @@ out vec2 uv;
 
 void main(){    
     WorldPos = vec3(_Model * vec4(vPos, 1));
-    WorldNormal = mat3(transpose(inverse(_Model))) * vNormal;
+    WorldNormal = _NormalMatrix * vNormal;
     uv = vUV; 
-    tangent = mat3(vTan, cross(WorldNormal, vTan), WorldNormal);
+    //Per vertex tangent frame, w carries the bitangent sign for mirrored UVs
+    vec3 N = normalize(WorldNormal);
+    vec3 T = normalize(mat3(_Model) * vTan.xyz);
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(N, T) * vTan.w;
+    tangent = mat3(T, B, N);
     gl_Position = _Projection * _View * _Model * vec4(vPos,1);
 }
 
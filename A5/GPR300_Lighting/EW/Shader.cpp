@@ -57,6 +57,11 @@ void Shader::setInt(std::string name, int value)
 	glProgramUniform1i(m_id, glGetUniformLocation(m_id, name.c_str()), value);
 }
 
+void Shader::setMat3(std::string name, const glm::mat3& value)
+{
+	glProgramUniformMatrix3fv(m_id, glGetUniformLocation(m_id, name.c_str()), 1, false, glm::value_ptr(value));
+}
+
 void Shader::setMat4(std::string name, const glm::mat4& value) { 
 	glProgramUniformMatrix4fv(m_id, glGetUniformLocation(m_id, name.c_str()), 1, false, glm::value_ptr(value));
 }
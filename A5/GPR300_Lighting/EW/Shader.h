@@ -12,6 +12,7 @@ public:
 	void use();
 	void setFloat(std::string name, float value);
 	void setInt(std::string name, int value);
+	void setMat3(std::string name, const glm::mat3& value);
 	void setMat4(std::string name, const glm::mat4& value);
 	void setVec2(std::string name, const glm::vec2& value);
 	void setVec3(std::string name, const glm::vec3& value);
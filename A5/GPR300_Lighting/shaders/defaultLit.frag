@@ -20,6 +20,7 @@ struct PointLight
     vec3 color;
     float intensity;
     float attenuation;
+    float range;
 };
 
 struct DirectionalLight
@@ -36,6 +37,7 @@ struct SpotLight
     vec3 direction;
     float intensity;
     float attenuation;
+    float range;
     float minAngle;
     float maxAngle;
 };
@@ -56,6 +58,14 @@ uniform DirectionalLight _DirectionalLight;
 uniform SpotLight _SpotLight;
 uniform Material _Material;
 
+//Inverse square past attenuation, windowed to reach 0 at range so a light never touches anything farther away
+float localLightFalloff(float dist, float attenuation, float range)
+{
+    float ratio = dist / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window * pow(attenuation / max(attenuation, dist), 2);
+}
+
 vec3 calculateDirectionalLight(DirectionalLight light)
 {
     vec3 result = vec3(0);
@@ -84,7 +94,7 @@ vec3 calculateSpotLight(SpotLight light)
     float intensity = light.intensity * i;
     vec3 viewDir = normalize(_ViewPos - WorldPos);
     vec3 halfway = normalize(lightDir + viewDir);
-    float attenuation = pow((light.attenuation / max(light.attenuation, distance(WorldPos, light.position))), 2);
+    float attenuation = localLightFalloff(distance(WorldPos, light.position), light.attenuation, light.range);
     float diff = _Material.diffuseK * max(dot(normal, lightDir), 0.0);
     float spec = _Material.specularK * pow(max(dot(normal, halfway), 0.0), _Material.shininess);
     vec3 diffuse = diff * light.color * intensity * attenuation;
@@ -101,7 +111,7 @@ vec3 calculatePointLight(PointLight light)
     vec3 lightDir = normalize(light.position - WorldPos);
     vec3 viewDir = normalize(_ViewPos - WorldPos);
     vec3 halfway = normalize(lightDir + viewDir);
-    float attenuation = pow((light.attenuation / max(light.attenuation, distance(WorldPos, light.position))), 2);
+    float attenuation = localLightFalloff(distance(WorldPos, light.position), light.attenuation, light.range);
     float diff = _Material.diffuseK * max(dot(normal, lightDir), 0.0);
     float spec = _Material.specularK * pow(max(dot(normal, halfway), 0.0), _Material.shininess);
     vec3 diffuse = diff * light.color * light.intensity * attenuation;
@@ -0,0 +1,377 @@
+#include "Bvh.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+
+namespace ew {
+	//Subtrees smaller than this are built on the thread that split them
+	const int PARALLEL_MIN_OBJECTS = 4096;
+	//Enough for any tree built from an int count of objects
+	const int MAX_STACK_DEPTH = 128;
+
+	static float surfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0));
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	void Bvh::build(const glm::vec3* boundsMin, const glm::vec3* boundsMax, int count, bool parallel)
+	{
+		mObjectMin.assign(boundsMin, boundsMin + count);
+		mObjectMax.assign(boundsMax, boundsMax + count);
+		rebuild(parallel);
+	}
+
+	void Bvh::rebuild(bool parallel)
+	{
+		int count = getObjectCount();
+		//The build partitions copies of the bounds instead of indices, so every pass reads memory in order
+		std::vector<BuildRef> refs(count);
+		mObjectIndices.resize(count);
+		mObjectLeaves.resize(count);
+		for (int i = 0; i < count; i++) {
+			refs[i] = { mObjectMin[i], i, mObjectMax[i] };
+		}
+		int maxNodes = std::max(1, count * 2 - 1);
+		mNodes.resize(maxNodes);
+		mParents.resize(maxNodes);
+		mParents[0] = -1;
+		mNextNode = 1;
+
+		//One level of parallel splits per doubling of the worker count
+		int parallelDepth = 0;
+		while (parallel && (1 << parallelDepth) < getWorkerCount()) {
+			parallelDepth++;
+		}
+		if (count == 0) {
+			mNodes[0] = { glm::vec3(0), 0, glm::vec3(0), 0 };
+		}
+		else {
+			buildNode(refs.data(), 0, 0, count, 0, parallelDepth);
+		}
+		mNodeCount = mNextNode;
+		mDirty.assign(mNodeCount, 0);
+		mAnyDirty = false;
+
+		mSahAreaSum = 0.0;
+		for (int i = 0; i < mNodeCount; i++) {
+			mSahAreaSum += getNodeCost(i);
+		}
+		float rootArea = surfaceArea(mNodes[0].boundsMin, mNodes[0].boundsMax);
+		mSahCost = mBuiltSahCost = rootArea > 0.0f ? (float)(mSahAreaSum / rootArea) : 0.0f;
+	}
+
+	//Area weighted cost of one node: traversal for inner nodes, one box test per object for leaves
+	float Bvh::getNodeCost(int node)const
+	{
+		const Node& n = mNodes[node];
+		return surfaceArea(n.boundsMin, n.boundsMax) * (n.count > 0 ? (float)n.count : 1.0f);
+	}
+
+	void Bvh::buildNode(BuildRef* refs, int node, int begin, int end, int depth, int parallelDepth)
+	{
+		Node& n = mNodes[node];
+		glm::vec3 boundsMin = glm::vec3(FLT_MAX), boundsMax = glm::vec3(-FLT_MAX);
+		glm::vec3 centroidMin = glm::vec3(FLT_MAX), centroidMax = glm::vec3(-FLT_MAX);
+		for (int i = begin; i < end; i++) {
+			boundsMin = glm::min(boundsMin, refs[i].boundsMin);
+			boundsMax = glm::max(boundsMax, refs[i].boundsMax);
+			glm::vec3 centroid = (refs[i].boundsMin + refs[i].boundsMax) * 0.5f;
+			centroidMin = glm::min(centroidMin, centroid);
+			centroidMax = glm::max(centroidMax, centroid);
+		}
+		n.boundsMin = boundsMin;
+		n.boundsMax = boundsMax;
+		int count = end - begin;
+
+		auto makeLeaf = [&]() {
+			n.first = begin;
+			n.count = count;
+			for (int i = begin; i < end; i++) {
+				mObjectIndices[i] = refs[i].object;
+				mObjectLeaves[refs[i].object] = node;
+			}
+		};
+		if (count <= MAX_LEAF_OBJECTS) {
+			makeLeaf();
+			return;
+		}
+
+		//Bin centroids along all three axes in one pass, then sweep each axis for the cheapest split plane
+		glm::vec3 centroidExtent = centroidMax - centroidMin;
+		glm::vec3 binScale = glm::vec3(0);
+		for (int axis = 0; axis < 3; axis++) {
+			binScale[axis] = centroidExtent[axis] > 0.0f ? SAH_BINS / centroidExtent[axis] : 0.0f;
+		}
+		glm::vec3 binMin[3][SAH_BINS], binMax[3][SAH_BINS];
+		int binCount[3][SAH_BINS] = {};
+		for (int axis = 0; axis < 3; axis++) {
+			for (int b = 0; b < SAH_BINS; b++) {
+				binMin[axis][b] = glm::vec3(FLT_MAX);
+				binMax[axis][b] = glm::vec3(-FLT_MAX);
+			}
+		}
+		for (int i = begin; i < end; i++) {
+			glm::vec3 objectMin = refs[i].boundsMin, objectMax = refs[i].boundsMax;
+			glm::vec3 binPosition = ((objectMin + objectMax) * 0.5f - centroidMin) * binScale;
+			for (int axis = 0; axis < 3; axis++) {
+				int b = std::min(SAH_BINS - 1, (int)binPosition[axis]);
+				binCount[axis][b]++;
+				binMin[axis][b] = glm::min(binMin[axis][b], objectMin);
+				binMax[axis][b] = glm::max(binMax[axis][b], objectMax);
+			}
+		}
+
+		int bestAxis = -1, bestSplit = 0;
+		float bestCost = FLT_MAX;
+		for (int axis = 0; axis < 3; axis++) {
+			if (centroidExtent[axis] <= 0.0f) {
+				continue;
+			}
+			//Right side costs first, then sweep left to right
+			float rightCost[SAH_BINS];
+			glm::vec3 sweepMin = glm::vec3(FLT_MAX), sweepMax = glm::vec3(-FLT_MAX);
+			int sweepCount = 0;
+			for (int b = SAH_BINS - 1; b > 0; b--) {
+				sweepMin = glm::min(sweepMin, binMin[axis][b]);
+				sweepMax = glm::max(sweepMax, binMax[axis][b]);
+				sweepCount += binCount[axis][b];
+				rightCost[b] = sweepCount > 0 ? surfaceArea(sweepMin, sweepMax) * sweepCount : 0.0f;
+			}
+			sweepMin = glm::vec3(FLT_MAX);
+			sweepMax = glm::vec3(-FLT_MAX);
+			sweepCount = 0;
+			for (int b = 0; b < SAH_BINS - 1; b++) {
+				sweepMin = glm::min(sweepMin, binMin[axis][b]);
+				sweepMax = glm::max(sweepMax, binMax[axis][b]);
+				sweepCount += binCount[axis][b];
+				if (sweepCount == 0 || sweepCount == count) {
+					continue;
+				}
+				float cost = surfaceArea(sweepMin, sweepMax) * sweepCount + rightCost[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		int middle;
+		if (bestAxis < 0) {
+			//Every centroid in the same spot, no plane separates them. Halve by index so leaves stay small
+			middle = begin + count / 2;
+		}
+		else {
+			float axisMin = centroidMin[bestAxis];
+			float axisScale = binScale[bestAxis];
+			BuildRef* split = std::partition(refs + begin, refs + end, [&](const BuildRef& ref) {
+				float centroid = (ref.boundsMin[bestAxis] + ref.boundsMax[bestAxis]) * 0.5f;
+				return std::min(SAH_BINS - 1, (int)((centroid - axisMin) * axisScale)) < bestSplit;
+			});
+			middle = (int)(split - refs);
+		}
+
+		int left = mNextNode.fetch_add(2);
+		n.first = left;
+		n.count = 0;
+		mParents[left] = node;
+		mParents[left + 1] = node;
+		if (depth < parallelDepth && count >= PARALLEL_MIN_OBJECTS) {
+			std::thread leftThread(&Bvh::buildNode, this, refs, left, begin, middle, depth + 1, parallelDepth);
+			buildNode(refs, left + 1, middle, end, depth + 1, parallelDepth);
+			leftThread.join();
+		}
+		else {
+			buildNode(refs, left, begin, middle, depth + 1, parallelDepth);
+			buildNode(refs, left + 1, middle, end, depth + 1, parallelDepth);
+		}
+	}
+
+	void Bvh::setBounds(int object, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		mObjectMin[object] = boundsMin;
+		mObjectMax[object] = boundsMax;
+		//Stop at the first node already marked, everything above it is too
+		for (int node = mObjectLeaves[object]; node >= 0 && !mDirty[node]; node = mParents[node]) {
+			mDirty[node] = 1;
+		}
+		mAnyDirty = true;
+	}
+
+	void Bvh::updateNodeBounds(int node)
+	{
+		Node& n = mNodes[node];
+		if (n.count > 0) {
+			n.boundsMin = glm::vec3(FLT_MAX);
+			n.boundsMax = glm::vec3(-FLT_MAX);
+			for (int i = n.first; i < n.first + n.count; i++) {
+				n.boundsMin = glm::min(n.boundsMin, mObjectMin[mObjectIndices[i]]);
+				n.boundsMax = glm::max(n.boundsMax, mObjectMax[mObjectIndices[i]]);
+			}
+		}
+		else {
+			n.boundsMin = glm::min(mNodes[n.first].boundsMin, mNodes[n.first + 1].boundsMin);
+			n.boundsMax = glm::max(mNodes[n.first].boundsMax, mNodes[n.first + 1].boundsMax);
+		}
+	}
+
+	void Bvh::refit()
+	{
+		mLastRefitNodeCount = 0;
+		if (!mAnyDirty) {
+			return;
+		}
+		//Children always come after their parent, so a backwards sweep finishes them first.
+		//Tracks the change in SAH cost as it goes instead of summing the whole tree again
+		for (int node = mNodeCount - 1; node >= 0; node--) {
+			if (!mDirty[node]) {
+				continue;
+			}
+			mSahAreaSum -= getNodeCost(node);
+			updateNodeBounds(node);
+			mSahAreaSum += getNodeCost(node);
+			mDirty[node] = 0;
+			mLastRefitNodeCount++;
+		}
+		float rootArea = surfaceArea(mNodes[0].boundsMin, mNodes[0].boundsMax);
+		mSahCost = rootArea > 0.0f ? (float)(mSahAreaSum / rootArea) : 0.0f;
+		mAnyDirty = false;
+	}
+
+	void Bvh::queryFrustum(const FrustumPlanes& planes, std::vector<int>& outObjects)const
+	{
+		outObjects.clear();
+		if (getObjectCount() == 0) {
+			return;
+		}
+		//Each entry carries the planes its node still straddles, a node inside a plane drops it for its children
+		struct Entry { int node; int planeMask; };
+		Entry stack[MAX_STACK_DEPTH];
+		int stackSize = 0;
+		stack[stackSize++] = { 0, (1 << FrustumPlanes::NUM_PLANES) - 1 };
+
+		auto classify = [&](const glm::vec3& boundsMin, const glm::vec3& boundsMax, int& planeMask) {
+			glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+			glm::vec3 extents = (boundsMax - boundsMin) * 0.5f;
+			for (int p = 0; p < FrustumPlanes::NUM_PLANES; p++) {
+				if (!(planeMask & (1 << p))) {
+					continue;
+				}
+				glm::vec4 plane = planes.getPlane(p);
+				float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+				float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+				if (distance + radius < 0.0f) {
+					return false;
+				}
+				if (distance - radius >= 0.0f) {
+					planeMask &= ~(1 << p);
+				}
+			}
+			return true;
+		};
+
+		while (stackSize > 0) {
+			Entry entry = stack[--stackSize];
+			const Node& n = mNodes[entry.node];
+			int planeMask = entry.planeMask;
+			if (planeMask != 0 && !classify(n.boundsMin, n.boundsMax, planeMask)) {
+				continue;
+			}
+			if (n.count == 0) {
+				stack[stackSize++] = { n.first + 1, planeMask };
+				stack[stackSize++] = { n.first, planeMask };
+				continue;
+			}
+			for (int i = n.first; i < n.first + n.count; i++) {
+				int object = mObjectIndices[i];
+				int objectMask = planeMask;
+				if (objectMask == 0 || classify(mObjectMin[object], mObjectMax[object], objectMask)) {
+					outObjects.push_back(object);
+				}
+			}
+		}
+	}
+
+	void Bvh::queryOverlap(const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<int>& outObjects)const
+	{
+		outObjects.clear();
+		if (getObjectCount() == 0) {
+			return;
+		}
+		auto overlaps = [&](const glm::vec3& otherMin, const glm::vec3& otherMax) {
+			return glm::all(glm::lessThanEqual(boundsMin, otherMax)) && glm::all(glm::lessThanEqual(otherMin, boundsMax));
+		};
+		int stack[MAX_STACK_DEPTH];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const Node& n = mNodes[stack[--stackSize]];
+			if (!overlaps(n.boundsMin, n.boundsMax)) {
+				continue;
+			}
+			if (n.count == 0) {
+				stack[stackSize++] = n.first + 1;
+				stack[stackSize++] = n.first;
+				continue;
+			}
+			for (int i = n.first; i < n.first + n.count; i++) {
+				int object = mObjectIndices[i];
+				if (overlaps(mObjectMin[object], mObjectMax[object])) {
+					outObjects.push_back(object);
+				}
+			}
+		}
+	}
+
+	int Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& outDistance)const
+	{
+		int hitObject = -1;
+		outDistance = maxDistance;
+		if (getObjectCount() == 0) {
+			return -1;
+		}
+		glm::vec3 inverseDirection = 1.0f / direction;
+		//Slab test, returns the entry distance or FLT_MAX on a miss or anything past the closest hit so far
+		auto intersect = [&](const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+			glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+			glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+			glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+			float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+			float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, outDistance));
+			return enter <= exit ? enter : FLT_MAX;
+		};
+		int stack[MAX_STACK_DEPTH];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const Node& n = mNodes[stack[--stackSize]];
+			if (intersect(n.boundsMin, n.boundsMax) == FLT_MAX) {
+				continue;
+			}
+			if (n.count == 0) {
+				//Nearer child goes on top so closer hits shrink the ray before the far side is visited
+				float leftDistance = intersect(mNodes[n.first].boundsMin, mNodes[n.first].boundsMax);
+				float rightDistance = intersect(mNodes[n.first + 1].boundsMin, mNodes[n.first + 1].boundsMax);
+				bool leftFirst = leftDistance <= rightDistance;
+				if (std::max(leftDistance, rightDistance) != FLT_MAX) {
+					stack[stackSize++] = leftFirst ? n.first + 1 : n.first;
+				}
+				if (std::min(leftDistance, rightDistance) != FLT_MAX) {
+					stack[stackSize++] = leftFirst ? n.first : n.first + 1;
+				}
+				continue;
+			}
+			for (int i = n.first; i < n.first + n.count; i++) {
+				int object = mObjectIndices[i];
+				float distance = intersect(mObjectMin[object], mObjectMax[object]);
+				if (distance < outDistance) {
+					outDistance = distance;
+					hitObject = object;
+				}
+			}
+		}
+		return hitObject;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Camera.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <atomic>
+
+namespace ew {
+	/// <summary>
+	/// Bounding volume hierarchy over world space object AABBs. Built top down with binned SAH, the top of the tree
+	/// in parallel. Moving objects are handled by refitting only the nodes above them; once refits have grown the
+	/// tree's SAH cost too far past what the last build made, needsRebuild() says so. No GL, main thread only
+	/// except for the build's own workers
+	/// </summary>
+	class Bvh {
+	public:
+		//Objects are ids 0 to count - 1
+		void build(const glm::vec3* boundsMin, const glm::vec3* boundsMax, int count, bool parallel = true);
+		//Rebuilds from the bounds currently stored, keeping the object count
+		void rebuild(bool parallel = true);
+		//Marks the object's leaf for the next refit
+		void setBounds(int object, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+		//Refits the nodes above objects changed by setBounds since the last refit/build
+		void refit();
+		//True once the SAH cost is REBUILD_COST_RATIO times the cost right after the last build
+		inline bool needsRebuild()const { return mSahCost > mBuiltSahCost * REBUILD_COST_RATIO; }
+		inline float getSahCost()const { return mSahCost; }
+
+		//Objects whose box is at least partly inside the planes. Subtrees fully inside are taken without further tests
+		void queryFrustum(const FrustumPlanes& planes, std::vector<int>& outObjects)const;
+		//Objects whose box overlaps [boundsMin, boundsMax]
+		void queryOverlap(const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<int>& outObjects)const;
+		//Closest object box hit by the ray within maxDistance, or -1. direction doesn't need to be normalized,
+		//outDistance is in units of its length
+		int raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& outDistance)const;
+
+		inline int getObjectCount()const { return (int)mObjectMin.size(); }
+		inline int getNodeCount()const { return mNodeCount; }
+		inline int getLastRefitNodeCount()const { return mLastRefitNodeCount; }
+
+		static constexpr int MAX_LEAF_OBJECTS = 4;
+		static constexpr int SAH_BINS = 12;
+		static constexpr float REBUILD_COST_RATIO = 1.5f;
+	private:
+		//32 bytes. Leaves have count > 0 and their objects at mObjectIndices[first...first + count).
+		//Inner nodes have count 0 and their children at first and first + 1
+		struct Node {
+			glm::vec3 boundsMin;
+			int first;
+			glm::vec3 boundsMax;
+			int count;
+		};
+
+		struct BuildRef {
+			glm::vec3 boundsMin;
+			int object;
+			glm::vec3 boundsMax;
+		};
+
+		void buildNode(BuildRef* refs, int node, int begin, int end, int depth, int parallelDepth);
+		void updateNodeBounds(int node);
+		float getNodeCost(int node)const;
+
+		std::vector<Node> mNodes;
+		std::vector<int> mParents;
+		std::atomic<int> mNextNode{ 0 };
+		int mNodeCount = 0;
+		std::vector<int> mObjectIndices;
+		std::vector<int> mObjectLeaves;
+		std::vector<glm::vec3> mObjectMin, mObjectMax;
+		//Per node, set by setBounds and cleared by refit
+		std::vector<unsigned char> mDirty;
+		bool mAnyDirty = false;
+		//Sum of getNodeCost over all nodes, in double so refits don't drift
+		double mSahAreaSum = 0.0;
+		float mSahCost = 0.0f;
+		float mBuiltSahCost = 0.0f;
+		int mLastRefitNodeCount = 0;
+	};
+}
@@ -4,6 +4,19 @@
 #include <glm/matrix.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+//Six planes as dot(normal, p) + distance >= 0 inside, stored one component per array so a SIMD
+//register loads the same component of every plane. Padded to 8, the last two repeat left/right
+struct FrustumPlanes {
+	enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, NUM_PLANES };
+	alignas(32) float normalX[8];
+	alignas(32) float normalY[8];
+	alignas(32) float normalZ[8];
+	alignas(32) float distance[8];
+	inline glm::vec4 getPlane(int i)const { return glm::vec4(normalX[i], normalY[i], normalZ[i], distance[i]); }
+};
+//Works for any view-projection, perspective or ortho, with GL's -w to w clip depth
+FrustumPlanes extractFrustumPlanes(const glm::mat4& viewProjection);
+
 class Camera {
 public:
 	Camera(float aspectRatio) : mAspectRatio(aspectRatio) {
@@ -13,20 +26,28 @@ public:
 	inline float getYaw()const { return mYaw; }
 	inline float getPitch()const { return mPitch; }
 	inline float getFov()const { return mFov; }
-	glm::vec3 getForward();
-	glm::mat4 getProjectionMatrix();
-	glm::mat4 getViewMatrix();
+	//Everything below is cached and only rebuilt on the first call after a setter
+	const glm::vec3& getForward()const;
+	const glm::mat4& getProjectionMatrix()const;
+	const glm::mat4& getViewMatrix()const;
+	const glm::mat4& getViewProjectionMatrix()const;
+	const glm::mat4& getInverseProjectionMatrix()const;
+	const glm::mat4& getInverseViewMatrix()const;
+	const glm::mat4& getInverseViewProjectionMatrix()const;
+	const FrustumPlanes& getFrustumPlanes()const;
 	//SETTERS
-	inline void setPosition(const glm::vec3 position) { mPosition = position; }
-	inline void setYaw(const float yaw) { mYaw = yaw; };
-	inline void setPitch(const float pitch) { mPitch = pitch; }
-	inline void setFov(const float fov) { mFov = glm::clamp(fov, 0.0f, 180.0f); }
-	inline void setNearPlane(const float nearPlane) { mNearPlane = nearPlane; }
-	inline void setFarPlane(const float farPlane) { mFarPlane = farPlane; }
-	inline void setOrthoSize(const float orthoSize) { mOrthoSize = orthoSize; }
-	inline void setOrtho(const bool ortho) { mOrtho = ortho; }
-	inline void setAspectRatio(const float aspectRatio) { mAspectRatio = aspectRatio; }
+	inline void setPosition(const glm::vec3 position) { mPosition = position; mViewDirty = true; }
+	inline void setYaw(const float yaw) { mYaw = yaw; mViewDirty = true; };
+	inline void setPitch(const float pitch) { mPitch = pitch; mViewDirty = true; }
+	inline void setFov(const float fov) { mFov = glm::clamp(fov, 0.0f, 180.0f); mProjectionDirty = true; }
+	inline void setNearPlane(const float nearPlane) { mNearPlane = nearPlane; mProjectionDirty = true; }
+	inline void setFarPlane(const float farPlane) { mFarPlane = farPlane; mProjectionDirty = true; }
+	inline void setOrthoSize(const float orthoSize) { mOrthoSize = orthoSize; mProjectionDirty = true; }
+	inline void setOrtho(const bool ortho) { mOrtho = ortho; mProjectionDirty = true; }
+	inline void setAspectRatio(const float aspectRatio) { mAspectRatio = aspectRatio; mProjectionDirty = true; }
 private:
+	void updateMatrices()const;
+
 	glm::vec3 mPosition = glm::vec3(0, 0, 5);
 	float mYaw = -90.0f;
 	float mPitch = 0.0f;
@@ -36,4 +57,11 @@ private:
 	float mOrthoSize = 7.5f;
 	bool mOrtho = false;
 	float mAspectRatio = 1.7777f;
+
+	mutable bool mViewDirty = true;
+	mutable bool mProjectionDirty = true;
+	mutable glm::vec3 mForward;
+	mutable glm::mat4 mView, mProjection, mViewProjection;
+	mutable glm::mat4 mInverseView, mInverseProjection, mInverseViewProjection;
+	mutable FrustumPlanes mFrustumPlanes;
 };
\ No newline at end of file
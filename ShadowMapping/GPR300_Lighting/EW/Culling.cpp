@@ -0,0 +1,164 @@
+#include "Culling.h"
+#include "Parallel.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <string.h>
+
+namespace ew {
+#if defined(__AVX2__)
+	typedef __m256 Lanes;
+	const int LANES = 8;
+	static inline Lanes lanesLoad(const float* p) { return _mm256_loadu_ps(p); }
+	static inline Lanes lanesSet(float a) { return _mm256_set1_ps(a); }
+	static inline Lanes lanesMulAdd(Lanes a, Lanes b, Lanes c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+	static inline Lanes lanesMul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+	static inline Lanes lanesMin(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+	static inline Lanes lanesAdd(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+	static inline Lanes lanesOr(Lanes a, Lanes b) { return _mm256_or_ps(a, b); }
+	static inline int lanesSignMask(Lanes a) { return _mm256_movemask_ps(a); }
+#else
+	typedef __m128 Lanes;
+	const int LANES = 4;
+	static inline Lanes lanesLoad(const float* p) { return _mm_loadu_ps(p); }
+	static inline Lanes lanesSet(float a) { return _mm_set1_ps(a); }
+	static inline Lanes lanesMulAdd(Lanes a, Lanes b, Lanes c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static inline Lanes lanesMul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	static inline Lanes lanesMin(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+	static inline Lanes lanesAdd(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+	static inline Lanes lanesOr(Lanes a, Lanes b) { return _mm_or_ps(a, b); }
+	static inline int lanesSignMask(Lanes a) { return _mm_movemask_ps(a); }
+#endif
+	//Storage padding, independent of LANES so both builds share the layout
+	const int PADDING = 8;
+	//Entries per worker below which threading costs more than it saves
+	const int MIN_PER_THREAD = 16384;
+
+	int CullingBounds::add()
+	{
+		int id = mCount++;
+		if (mCount > (int)mRadius.size()) {
+			size_t paddedCount = mRadius.size() + PADDING;
+			mCenterX.resize(paddedCount, 0.0f); mCenterY.resize(paddedCount, 0.0f); mCenterZ.resize(paddedCount, 0.0f);
+			mExtentX.resize(paddedCount, 0.0f); mExtentY.resize(paddedCount, 0.0f); mExtentZ.resize(paddedCount, 0.0f);
+			mRadius.resize(paddedCount, -FLT_MAX);
+		}
+		return id;
+	}
+
+	int CullingBounds::addSphere(const glm::vec3& center, float radius)
+	{
+		int id = add();
+		setSphere(id, center, radius);
+		return id;
+	}
+
+	int CullingBounds::addBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		int id = add();
+		setBox(id, boundsMin, boundsMax);
+		return id;
+	}
+
+	void CullingBounds::setSphere(int id, const glm::vec3& center, float radius)
+	{
+		mCenterX[id] = center.x; mCenterY[id] = center.y; mCenterZ[id] = center.z;
+		mExtentX[id] = radius; mExtentY[id] = radius; mExtentZ[id] = radius;
+		mRadius[id] = radius;
+	}
+
+	void CullingBounds::setBox(int id, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		glm::vec3 extents = (boundsMax - boundsMin) * 0.5f;
+		mCenterX[id] = center.x; mCenterY[id] = center.y; mCenterZ[id] = center.z;
+		mExtentX[id] = extents.x; mExtentY[id] = extents.y; mExtentZ[id] = extents.z;
+		mRadius[id] = glm::length(extents);
+	}
+
+	void CullingBounds::clear()
+	{
+		mCount = 0;
+		mCenterX.clear(); mCenterY.clear(); mCenterZ.clear();
+		mExtentX.clear(); mExtentY.clear(); mExtentZ.clear();
+		mRadius.clear();
+	}
+
+	void CullingBounds::cull(const FrustumPlanes& planes, std::vector<int>& visible, bool parallel)const
+	{
+		//Each chunk compacts its visible ids in place at the start of its own range, then the ranges are joined.
+		//Stores are unconditional, so leave room for a whole block past the end
+		visible.resize(mCount + LANES);
+		int numBlocks = (mCount + LANES - 1) / LANES;
+		int numChunks = parallel ? std::max(1, std::min(getWorkerCount(), mCount / MIN_PER_THREAD)) : 1;
+		int blocksPerChunk = (numBlocks + numChunks - 1) / std::max(1, numChunks);
+		std::vector<int> chunkCounts(numChunks, 0);
+		int* out = visible.data();
+
+		parallelFor(numChunks, 1, [&](int chunkBegin, int chunkEnd) {
+			for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+				int begin = chunk * blocksPerChunk * LANES;
+				int end = std::min(numBlocks, (chunk + 1) * blocksPerChunk) * LANES;
+				int numVisible = 0;
+				for (int i = begin; i < end; i += LANES) {
+					Lanes cx = lanesLoad(&mCenterX[i]), cy = lanesLoad(&mCenterY[i]), cz = lanesLoad(&mCenterZ[i]);
+					Lanes ex = lanesLoad(&mExtentX[i]), ey = lanesLoad(&mExtentY[i]), ez = lanesLoad(&mExtentZ[i]);
+					Lanes radius = lanesLoad(&mRadius[i]);
+					//Sign bit set once the entry is fully outside any plane
+					Lanes outside = lanesSet(0.0f);
+					for (int p = 0; p < FrustumPlanes::NUM_PLANES; p++) {
+						Lanes distance = lanesMulAdd(cx, lanesSet(planes.normalX[p]),
+							lanesMulAdd(cy, lanesSet(planes.normalY[p]),
+							lanesMulAdd(cz, lanesSet(planes.normalZ[p]), lanesSet(planes.distance[p]))));
+						Lanes boxRadius = lanesMulAdd(ex, lanesSet(fabsf(planes.normalX[p])),
+							lanesMulAdd(ey, lanesSet(fabsf(planes.normalY[p])),
+							lanesMul(ez, lanesSet(fabsf(planes.normalZ[p])))));
+						outside = lanesOr(outside, lanesAdd(distance, lanesMin(radius, boxRadius)));
+					}
+					int mask = ~lanesSignMask(outside);
+					int* blockOut = out + begin + numVisible;
+					for (int lane = 0; lane < LANES; lane++) {
+						blockOut[0] = i + lane;
+						blockOut += (mask >> lane) & 1;
+					}
+					numVisible = (int)(blockOut - (out + begin));
+				}
+				chunkCounts[chunk] = numVisible;
+			}
+		});
+
+		int numVisible = chunkCounts[0];
+		for (int chunk = 1; chunk < numChunks; chunk++) {
+			memmove(out + numVisible, out + chunk * blocksPerChunk * LANES, chunkCounts[chunk] * sizeof(int));
+			numVisible += chunkCounts[chunk];
+		}
+		visible.resize(numVisible);
+	}
+
+	bool isBoxVisible(const FrustumPlanes& planes, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		glm::vec3 extents = (boundsMax - boundsMin) * 0.5f;
+		for (int p = 0; p < FrustumPlanes::NUM_PLANES; p++) {
+			glm::vec4 plane = planes.getPlane(p);
+			glm::vec3 normal = glm::vec3(plane);
+			if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extents) < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	FrustumPlanes extractShadowCasterPlanes(const glm::mat4& lightView, const glm::vec3& receiverMin, const glm::vec3& receiverMax)
+	{
+		//Light view looks down -Z, so the furthest receiver has the smallest z
+		glm::mat4 projection = glm::ortho(receiverMin.x, receiverMax.x, receiverMin.y, receiverMax.y, -receiverMax.z, -receiverMin.z);
+		FrustumPlanes planes = extractFrustumPlanes(projection * lightView);
+		planes.normalX[FrustumPlanes::NEAR_PLANE] = 0.0f;
+		planes.normalY[FrustumPlanes::NEAR_PLANE] = 0.0f;
+		planes.normalZ[FrustumPlanes::NEAR_PLANE] = 0.0f;
+		planes.distance[FrustumPlanes::NEAR_PLANE] = 1.0f;
+		return planes;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "Camera.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// World space bounds of many objects, stored one component per array so the frustum test runs on 8 objects at a time
+	/// in the project's AVX2 build (4 if built without /arch:AVX2). Every entry has a center, box half extents and a radius, and is tested with whichever of the
+	/// sphere and the box is tighter against each plane: spheres get extents = radius, boxes get the radius of their corner.
+	/// No GL, so it can be used and tested without a context
+	/// </summary>
+	class CullingBounds {
+	public:
+		int addSphere(const glm::vec3& center, float radius);
+		int addBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+		void setSphere(int id, const glm::vec3& center, float radius);
+		void setBox(int id, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+		void clear();
+		inline int getCount()const { return mCount; }
+
+		//Fills visible with the ids of entries at least partly inside all planes, in increasing order.
+		//Large sets are split across worker threads
+		void cull(const FrustumPlanes& planes, std::vector<int>& visible, bool parallel = true)const;
+	private:
+		int add();
+		int mCount = 0;
+		//Padded to a multiple of 8, padding entries have a radius of -FLT_MAX so they are never visible
+		std::vector<float> mCenterX, mCenterY, mCenterZ;
+		std::vector<float> mExtentX, mExtentY, mExtentZ;
+		std::vector<float> mRadius;
+	};
+
+	//Single box test, for the odd object that isn't worth a CullingBounds
+	bool isBoxVisible(const FrustumPlanes& planes, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	//Volume that can hold shadow casters for a set of receivers: receiverMin/Max are the receivers' bounds in light
+	//view space (already clipped to what the shadow map covers). The near plane is dropped, so casters between the
+	//light and the receivers are kept however far back they are; draw them with GL_DEPTH_CLAMP so they still land in the map
+	FrustumPlanes extractShadowCasterPlanes(const glm::mat4& lightView, const glm::vec3& receiverMin, const glm::vec3& receiverMax);
+}
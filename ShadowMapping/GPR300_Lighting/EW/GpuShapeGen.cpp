@@ -0,0 +1,124 @@
+#include "GpuShapeGen.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ew {
+	//Matches _Shape in shapegen.comp
+	const int GPU_SHAPE_SPHERE = 0;
+	const int GPU_SHAPE_CYLINDER = 1;
+	const int GPU_SHAPE_PLANE = 2;
+	const int SHAPEGEN_GROUP_SIZE = 64;
+
+	GpuMesh::GpuMesh(Shader* shapeGenShader)
+		: mShapeGenShader(shapeGenShader)
+	{
+		glGenVertexArrays(1, &mVAO);
+	}
+
+	GpuMesh::~GpuMesh()
+	{
+		glDeleteVertexArrays(1, &mVAO);
+		glDeleteBuffers(1, &mVBO);
+		glDeleteBuffers(1, &mEBO);
+	}
+
+	void GpuMesh::allocate(GLsizei numVertices, GLsizei numIndices)
+	{
+		if (numVertices <= mVertexCapacity && numIndices <= mIndexCapacity) {
+			return;
+		}
+		//Storage is immutable, so growing means new buffers. Round up so small changes don't reallocate every time
+		mVertexCapacity = std::max(numVertices + numVertices / 2, mVertexCapacity);
+		mIndexCapacity = std::max(numIndices + numIndices / 2, mIndexCapacity);
+		glDeleteBuffers(1, &mVBO);
+		glDeleteBuffers(1, &mEBO);
+
+		glBindVertexArray(mVAO);
+		glGenBuffers(1, &mVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+		glBufferStorage(GL_ARRAY_BUFFER, mVertexCapacity * sizeof(Vertex), NULL, 0);
+
+		glGenBuffers(1, &mEBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+		glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, mIndexCapacity * sizeof(unsigned int), NULL, 0);
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, position)));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, normal)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, UV)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, tangent)));
+		glEnableVertexAttribArray(3);
+		glBindVertexArray(0);
+	}
+
+	void GpuMesh::generate(int shape, const glm::vec2& params, int numSegments, GLsizei numVertices, GLsizei numTriangles)
+	{
+		allocate(numVertices, numTriangles * 3);
+		mNumVertices = numVertices;
+		mNumIndices = numTriangles * 3;
+
+		mShapeGenShader->use();
+		mShapeGenShader->setInt("_Shape", shape);
+		mShapeGenShader->setVec2("_Params", params);
+		mShapeGenShader->setInt("_NumSegments", numSegments);
+		mShapeGenShader->setInt("_NumVertices", numVertices);
+		mShapeGenShader->setInt("_NumTriangles", numTriangles);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mVBO);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mEBO);
+		GLuint numGroups = (GLuint)((std::max(numVertices, numTriangles) + SHAPEGEN_GROUP_SIZE - 1) / SHAPEGEN_GROUP_SIZE);
+		glDispatchCompute(numGroups, 1, 1);
+		//Vertex fetch, index fetch and readback all see the compute writes
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	}
+
+	//Counts below match createSphere and createCylinder, including createSphere's extra bottom cap triangle
+	void GpuMesh::generateSphere(float radius, int numSegments)
+	{
+		GLsizei numVertices = (numSegments - 1) * (numSegments + 1) + 2;
+		GLsizei numTriangles = numSegments + numSegments * (numSegments - 2) * 2 + (numSegments + 1);
+		generate(GPU_SHAPE_SPHERE, glm::vec2(radius, 0), numSegments, numVertices, numTriangles);
+	}
+
+	void GpuMesh::generateCylinder(float height, float radius, int numSegments)
+	{
+		generate(GPU_SHAPE_CYLINDER, glm::vec2(height, radius), numSegments, (numSegments + 1) * 4 + 2, numSegments * 4);
+	}
+
+	void GpuMesh::generatePlane(float width, float height)
+	{
+		generate(GPU_SHAPE_PLANE, glm::vec2(width, height), 0, 4, 2);
+	}
+
+	void GpuMesh::draw()
+	{
+		glBindVertexArray(mVAO);
+		glDrawElements(GL_TRIANGLES, mNumIndices, GL_UNSIGNED_INT, 0);
+	}
+
+	float GpuMesh::compareTo(const MeshData& reference)
+	{
+		if ((size_t)mNumVertices != reference.vertices.size() || (size_t)mNumIndices != reference.indices.size()) {
+			return -1.0f;
+		}
+		std::vector<Vertex> vertices(mNumVertices);
+		std::vector<unsigned int> indices(mNumIndices);
+		glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+		glGetBufferSubData(GL_ARRAY_BUFFER, 0, mNumVertices * sizeof(Vertex), vertices.data());
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_COPY_READ_BUFFER, mEBO);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, mNumIndices * sizeof(unsigned int), indices.data());
+
+		if (indices != reference.indices) {
+			return -1.0f;
+		}
+		const float* gpu = (const float*)vertices.data();
+		const float* cpu = (const float*)reference.vertices.data();
+		float maxDifference = 0.0f;
+		for (size_t i = 0; i < vertices.size() * sizeof(Vertex) / sizeof(float); i++) {
+			maxDifference = std::max(maxDifference, fabsf(gpu[i] - cpu[i]));
+		}
+		return maxDifference;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "Mesh.h"
+#include "Shader.h"
+
+namespace ew {
+	/// <summary>
+	/// Mesh generated on the GPU by shaders/shapegen.comp, straight into immutable glBufferStorage buffers
+	/// the CPU can't write to. Regenerating only dispatches compute, buffers are reallocated only when a mesh outgrows them.
+	/// createSphere/createCylinder/createPlane stay the reference, see compareTo.
+	/// </summary>
+	class GpuMesh {
+	public:
+		GpuMesh(Shader* shapeGenShader);
+		~GpuMesh();
+		void generateSphere(float radius, int numSegments);
+		void generateCylinder(float height, float radius, int numSegments);
+		void generatePlane(float width, float height);
+		void draw();
+		//Conformance check against the CPU generator's output. Returns the largest difference of any
+		//vertex float, or -1 if the vertex count, index count or any index differs. Reads the buffers back, so debug only
+		float compareTo(const MeshData& reference);
+		inline GLsizei getNumVertices()const { return mNumVertices; }
+		inline GLsizei getNumIndices()const { return mNumIndices; }
+	private:
+		GpuMesh(const GpuMesh& r) = delete;
+		void generate(int shape, const glm::vec2& params, int numSegments, GLsizei numVertices, GLsizei numTriangles);
+		void allocate(GLsizei numVertices, GLsizei numIndices);
+		Shader* mShapeGenShader;
+		GLuint mVAO = 0, mVBO = 0, mEBO = 0;
+		GLsizei mVertexCapacity = 0, mIndexCapacity = 0;
+		GLsizei mNumVertices = 0, mNumIndices = 0;
+	};
+}
@@ -0,0 +1,146 @@
+#include "ImpostorBatch.h"
+#include "ShapeGen.h"
+#include "Parallel.h"
+
+namespace ew {
+	//Bounding box of the unit shapes
+	constexpr StaticMeshData<24, 36> IMPOSTOR_BOX = makeCube(1.0f, 1.0f, 1.0f);
+
+	//Laid out for glDrawElementsIndirect
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	//Matches local_size_x in shaders/impostorCull.comp
+	const int CULL_GROUP_SIZE = 64;
+
+	ImpostorBatch::ImpostorBatch()
+	{
+		glGenBuffers(1, &mVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(IMPOSTOR_BOX.vertices), IMPOSTOR_BOX.vertices.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &mEBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(IMPOSTOR_BOX.indices), IMPOSTOR_BOX.indices.data(), GL_STATIC_DRAW);
+		mNumIndices = (GLsizei)IMPOSTOR_BOX.indices.size();
+
+		glGenBuffers(1, &mInstanceVBO);
+		glGenBuffers(1, &mCulledInstanceVBO);
+		createVertexArray(mVAO, mInstanceVBO);
+		createVertexArray(mCulledVAO, mCulledInstanceVBO);
+
+		DrawElementsIndirectCommand command = { (GLuint)mNumIndices, 0, 0, 0, 0 };
+		glGenBuffers(1, &mIndirectBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	void ImpostorBatch::createVertexArray(GLuint& vao, GLuint instanceVBO)
+	{
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+
+		glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, position)));
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+
+		//A mat4 attribute takes 4 vec4 locations. Model at 4-7, inverse model at 8-11
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		for (int i = 0; i < 8; i++) {
+			glVertexAttribPointer(4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (const void*)(sizeof(glm::vec4) * i));
+			glEnableVertexAttribArray(4 + i);
+			glVertexAttribDivisor(4 + i, 1);
+		}
+		glBindVertexArray(0);
+	}
+
+	ImpostorBatch::~ImpostorBatch()
+	{
+		glDeleteVertexArrays(1, &mVAO);
+		glDeleteVertexArrays(1, &mCulledVAO);
+		glDeleteBuffers(1, &mVBO);
+		glDeleteBuffers(1, &mEBO);
+		glDeleteBuffers(1, &mInstanceVBO);
+		glDeleteBuffers(1, &mCulledInstanceVBO);
+		glDeleteBuffers(1, &mIndirectBuffer);
+	}
+
+	void ImpostorBatch::setInstances(const std::vector<glm::mat4>& models)
+	{
+		mInstanceCount = (int)models.size();
+		std::vector<Instance> instances(mInstanceCount);
+		parallelFor(mInstanceCount, 4096, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				instances[i].model = models[i];
+				instances[i].inverseModel = glm::inverse(models[i]);
+			}
+		});
+
+		glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+		//Only reallocate when growing
+		if (mInstanceCount > mInstanceCapacity) {
+			mInstanceCapacity = mInstanceCount;
+			glBufferData(GL_ARRAY_BUFFER, mInstanceCapacity * sizeof(Instance), instances.data(), GL_DYNAMIC_DRAW);
+			//Only ever written by the cull shader
+			glBindBuffer(GL_ARRAY_BUFFER, mCulledInstanceVBO);
+			glBufferData(GL_ARRAY_BUFFER, mInstanceCapacity * sizeof(Instance), nullptr, GL_DYNAMIC_COPY);
+		}
+		else if (mInstanceCount > 0) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, mInstanceCount * sizeof(Instance), instances.data());
+		}
+	}
+
+	void ImpostorBatch::draw()
+	{
+		if (mInstanceCount == 0) {
+			return;
+		}
+		//Back faces still cover the shape when the camera is inside the box
+		glCullFace(GL_FRONT);
+		glBindVertexArray(mVAO);
+		glDrawElementsInstanced(GL_TRIANGLES, mNumIndices, GL_UNSIGNED_INT, 0, mInstanceCount);
+		glCullFace(GL_BACK);
+	}
+
+	void ImpostorBatch::cull(Shader* cullShader, const FrustumPlanes& planes)
+	{
+		GLuint zero = 0;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(DrawElementsIndirectCommand, instanceCount), sizeof(zero), &zero);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		if (mInstanceCount == 0) {
+			return;
+		}
+		cullShader->use();
+		cullShader->setInt("_NumInstances", mInstanceCount);
+		for (int i = 0; i < FrustumPlanes::NUM_PLANES; i++) {
+			cullShader->setVec4("_Planes[" + std::to_string(i) + "]", planes.getPlane(i));
+		}
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mInstanceVBO);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mCulledInstanceVBO);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mIndirectBuffer);
+		glDispatchCompute((GLuint)((mInstanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+		//Instances are read as vertex attributes and the count as a draw command
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	}
+
+	void ImpostorBatch::drawCulled()
+	{
+		if (mInstanceCount == 0) {
+			return;
+		}
+		glCullFace(GL_FRONT);
+		glBindVertexArray(mCulledVAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+		glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glCullFace(GL_BACK);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Mesh.h"
+#include "Shader.h"
+#include "Camera.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Instanced bounding boxes for ray cast spheres/cylinders, drawn with shaders/impostor.vert.
+	/// Each instance is a model matrix applied to the unit shape: a sphere of radius 0.5 or a cylinder
+	/// along Y of height 1 and radius 0.5, same as the default ShapeGen meshes, so the same Transform works for both.
+	/// </summary>
+	class ImpostorBatch {
+	public:
+		ImpostorBatch();
+		~ImpostorBatch();
+		//Inverses are computed here, once, rather than per vertex in the shader
+		void setInstances(const std::vector<glm::mat4>& models);
+		//Set _Shape on the shader first. Draws back faces, so it restores GL_BACK culling afterwards
+		void draw();
+		//Frustum culls the instances on the GPU with shaders/impostorCull.comp, into a compacted instance buffer and an
+		//indirect draw command. Nothing is read back, so the CPU cost doesn't depend on the instance count
+		void cull(Shader* cullShader, const FrustumPlanes& planes);
+		//Draws what the last cull kept, with glDrawElementsIndirect. Same shaders and culling state as draw
+		void drawCulled();
+		inline int getInstanceCount()const { return mInstanceCount; }
+	private:
+		ImpostorBatch(const ImpostorBatch& r) = delete;
+		//Shares the box buffers, instance attributes come from instanceVBO
+		void createVertexArray(GLuint& vao, GLuint instanceVBO);
+		struct Instance {
+			glm::mat4 model;
+			glm::mat4 inverseModel;
+		};
+		GLuint mVAO, mVBO, mEBO, mInstanceVBO;
+		GLuint mCulledVAO, mCulledInstanceVBO, mIndirectBuffer;
+		GLsizei mNumIndices;
+		int mInstanceCount = 0;
+		int mInstanceCapacity = 0;
+	};
+}
@@ -0,0 +1,70 @@
+#include "JobQueue.h"
+
+namespace ew {
+	JobQueue::JobQueue(int numWorkers)
+	{
+		if (numWorkers < 1) {
+			numWorkers = 1;
+		}
+		mWorkers.reserve(numWorkers);
+		for (int i = 0; i < numWorkers; i++) {
+			mWorkers.emplace_back(&JobQueue::workerLoop, this);
+		}
+	}
+
+	JobQueue::~JobQueue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+			mJobs.clear();
+		}
+		mJobAvailable.notify_all();
+		for (std::thread& worker : mWorkers) {
+			worker.join();
+		}
+	}
+
+	void JobQueue::push(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJobs.push_back(std::move(job));
+		}
+		mJobAvailable.notify_one();
+	}
+
+	void JobQueue::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mIdle.wait(lock, [this] { return mJobs.empty() && mRunningJobs == 0; });
+	}
+
+	void JobQueue::workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mJobAvailable.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+				if (mStopping) {
+					return;
+				}
+				job = std::move(mJobs.front());
+				mJobs.pop_front();
+				mRunningJobs++;
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mRunningJobs--;
+				if (mJobs.empty() && mRunningJobs == 0) {
+					mIdle.notify_all();
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Fixed set of worker threads that run pushed jobs in FIFO order.
+	/// Jobs still queued when the JobQueue is destroyed are dropped, running ones are finished.
+	/// </summary>
+	class JobQueue {
+	public:
+		JobQueue(int numWorkers);
+		~JobQueue();
+		void push(std::function<void()> job);
+		//Blocks until every pushed job has finished
+		void waitIdle();
+		inline int getWorkerCount()const { return (int)mWorkers.size(); }
+	private:
+		JobQueue(const JobQueue& r) = delete;
+		void workerLoop();
+		std::vector<std::thread> mWorkers;
+		std::deque<std::function<void()>> mJobs;
+		std::mutex mMutex;
+		std::condition_variable mJobAvailable;
+		std::condition_variable mIdle;
+		int mRunningJobs = 0;
+		bool mStopping = false;
+	};
+}
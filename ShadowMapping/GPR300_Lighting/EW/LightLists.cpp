@@ -0,0 +1,193 @@
+#include "LightLists.h"
+#include "Parallel.h"
+#include <assert.h>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+namespace ew {
+	LightLists::LightLists()
+	{
+		glGenBuffers(1, &mUBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, mUBO);
+		glBufferData(GL_UNIFORM_BUFFER, MAX_LIGHTS * sizeof(LocalLight), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	LightLists::~LightLists()
+	{
+		glDeleteBuffers(1, &mUBO);
+	}
+
+	void LightLists::setLights(const std::vector<LocalLight>& lights)
+	{
+		assert(lights.size() <= MAX_LIGHTS);
+		mLights.assign(lights.begin(), lights.begin() + std::min((int)lights.size(), MAX_LIGHTS));
+		if (!mLights.empty()) {
+			glBindBuffer(GL_UNIFORM_BUFFER, mUBO);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, mLights.size() * sizeof(LocalLight), mLights.data());
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+	}
+
+	void LightLists::bind()const
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING, mUBO);
+	}
+
+	float LightLists::getInfluence(const LocalLight& light, const glm::vec3& boundsMin, const glm::vec3& boundsMax)const
+	{
+		float distance = glm::length(glm::clamp(light.position, boundsMin, boundsMax) - light.position);
+		if (distance >= light.range) {
+			return 0.0f;
+		}
+		if (light.cosOuterAngle > -1.0f) {
+			//Cone against the box's bounding sphere, distance from the center to the cone's surface
+			glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+			float radius = glm::length(boundsMax - center);
+			glm::vec3 toCenter = center - light.position;
+			float alongAxis = glm::dot(toCenter, light.direction);
+			float fromAxis = sqrtf(std::max(glm::dot(toCenter, toCenter) - alongAxis * alongAxis, 0.0f));
+			float sinOuterAngle = sqrtf(std::max(1.0f - light.cosOuterAngle * light.cosOuterAngle, 0.0f));
+			if (light.cosOuterAngle * fromAxis - sinOuterAngle * alongAxis > radius || alongAxis < -radius) {
+				return 0.0f;
+			}
+		}
+		float brightness = light.intensity * std::max(light.color.r, std::max(light.color.g, light.color.b));
+		return brightness * getLocalLightFalloff(distance, light.range);
+	}
+
+	void LightLists::buildGrid()
+	{
+		//Cells at least as big as the largest light, so a light lands in at most 2x2 of them
+		glm::vec2 gridMin = glm::vec2(FLT_MAX), gridMax = glm::vec2(-FLT_MAX);
+		float maxRange = 0.0f;
+		for (int light : mVisibleLights) {
+			glm::vec2 position = glm::vec2(mLights[light].position.x, mLights[light].position.z);
+			gridMin = glm::min(gridMin, position - mLights[light].range);
+			gridMax = glm::max(gridMax, position + mLights[light].range);
+			maxRange = std::max(maxRange, mLights[light].range);
+		}
+		if (mVisibleLights.empty()) {
+			gridMin = gridMax = glm::vec2(0);
+		}
+		mGridMin = gridMin;
+		mGridMax = gridMax;
+		mCellSize = std::max(std::max(maxRange * 2.0f, 0.001f), std::max(gridMax.x - gridMin.x, gridMax.y - gridMin.y) / MAX_GRID_CELLS);
+		mGridWidth = std::max(1, (int)ceilf((gridMax.x - gridMin.x) / mCellSize));
+		mGridHeight = std::max(1, (int)ceilf((gridMax.y - gridMin.y) / mCellSize));
+
+		//Counting sort of the lights into cells
+		mCellStarts.assign(mGridWidth * mGridHeight + 1, 0);
+		for (int pass = 0; pass < 2; pass++) {
+			for (int light : mVisibleLights) {
+				const LocalLight& l = mLights[light];
+				glm::ivec2 cellMin = getCell(glm::vec2(l.position.x, l.position.z) - l.range);
+				glm::ivec2 cellMax = getCell(glm::vec2(l.position.x, l.position.z) + l.range);
+				for (int y = cellMin.y; y <= cellMax.y; y++) {
+					for (int x = cellMin.x; x <= cellMax.x; x++) {
+						int cell = y * mGridWidth + x;
+						if (pass == 0) {
+							mCellStarts[cell + 1]++;
+						}
+						else {
+							mCellLights[mCellStarts[cell]++] = light;
+						}
+					}
+				}
+			}
+			if (pass == 0) {
+				for (int cell = 0; cell < mGridWidth * mGridHeight; cell++) {
+					mCellStarts[cell + 1] += mCellStarts[cell];
+				}
+				mCellLights.resize(mCellStarts.back());
+			}
+			else {
+				//Starts were advanced to the next cell's start, shift them back
+				for (int cell = mGridWidth * mGridHeight; cell > 0; cell--) {
+					mCellStarts[cell] = mCellStarts[cell - 1];
+				}
+				mCellStarts[0] = 0;
+			}
+		}
+	}
+
+	void LightLists::assign(const glm::vec3* boundsMin, const glm::vec3* boundsMax, const int* objects, int count, const FrustumPlanes& planes, bool parallel)
+	{
+		mVisibleLights.clear();
+		for (int i = 0; i < (int)mLights.size(); i++) {
+			bool visible = true;
+			for (int p = 0; p < FrustumPlanes::NUM_PLANES; p++) {
+				visible &= glm::dot(glm::vec3(planes.getPlane(p)), mLights[i].position) + planes.distance[p] >= -mLights[i].range;
+			}
+			if (visible) {
+				mVisibleLights.push_back(i);
+			}
+		}
+		buildGrid();
+
+		int maxObject = -1;
+		for (int i = 0; i < count; i++) {
+			maxObject = std::max(maxObject, objects[i]);
+		}
+		if ((int)mKeys.size() <= maxObject) {
+			mKeys.resize(maxObject + 1, EMPTY_KEY);
+		}
+
+		parallelFor(count, parallel ? 256 : INT_MAX, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				int object = objects[i];
+				const glm::vec3& objectMin = boundsMin[object];
+				const glm::vec3& objectMax = boundsMax[object];
+				//Kept sorted strongest first. Ties keep the lower light index, so results don't depend on threading
+				float scores[MAX_LIGHTS_PER_OBJECT];
+				int lights[MAX_LIGHTS_PER_OBJECT];
+				int numLights = 0;
+				bool inGrid = objectMax.x >= mGridMin.x && objectMax.z >= mGridMin.y && objectMin.x <= mGridMax.x && objectMin.z <= mGridMax.y;
+				glm::ivec2 cellMin = getCell(glm::vec2(objectMin.x, objectMin.z));
+				glm::ivec2 cellMax = getCell(glm::vec2(objectMax.x, objectMax.z));
+				bool multipleCells = cellMin != cellMax;
+				for (int y = cellMin.y; y <= cellMax.y && inGrid; y++) {
+					for (int x = cellMin.x; x <= cellMax.x; x++) {
+						int cell = y * mGridWidth + x;
+						for (int c = mCellStarts[cell]; c < mCellStarts[cell + 1]; c++) {
+							int light = mCellLights[c];
+							float score = getInfluence(mLights[light], objectMin, objectMax);
+							if (score <= 0.0f || (numLights == MAX_LIGHTS_PER_OBJECT && (score < scores[numLights - 1] ||
+								(score == scores[numLights - 1] && light > lights[numLights - 1])))) {
+								continue;
+							}
+							//A light overlapping several of the box's cells is seen once per cell
+							if (multipleCells && std::find(lights, lights + numLights, light) != lights + numLights) {
+								continue;
+							}
+							int slot = std::min(numLights, MAX_LIGHTS_PER_OBJECT - 1);
+							while (slot > 0 && (scores[slot - 1] < score || (scores[slot - 1] == score && lights[slot - 1] > light))) {
+								scores[slot] = scores[slot - 1];
+								lights[slot] = lights[slot - 1];
+								slot--;
+							}
+							scores[slot] = score;
+							lights[slot] = light;
+							numLights = std::min(numLights + 1, MAX_LIGHTS_PER_OBJECT);
+						}
+					}
+				}
+				std::sort(lights, lights + numLights);
+				uint64_t key = EMPTY_KEY;
+				for (int slot = 0; slot < numLights; slot++) {
+					key &= ~(0xffffull << (slot * 16));
+					key |= (uint64_t)lights[slot] << (slot * 16);
+				}
+				mKeys[object] = key;
+			}
+		});
+
+		mLastAssignedCount = 0;
+		for (int i = 0; i < count; i++) {
+			for (int slot = 0; slot < MAX_LIGHTS_PER_OBJECT; slot++) {
+				mLastAssignedCount += getKeyLight(mKeys[objects[i]], slot) >= 0;
+			}
+		}
+	}
+}
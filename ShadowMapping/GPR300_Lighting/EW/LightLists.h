@@ -0,0 +1,93 @@
+#pragma once
+#include "Camera.h"
+#include "GL/glew.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+namespace ew {
+	/// <summary>
+	/// Point or spot light that reaches exactly nothing past its range. Laid out like LocalLight in
+	/// shaders/lighting.glsl (std140). Point lights have cosOuterAngle = -2 and cosInnerAngle = -1, a cone that never cuts anything
+	/// </summary>
+	struct LocalLight {
+		glm::vec3 position;
+		float range;
+		glm::vec3 color;
+		float intensity;
+		glm::vec3 direction;
+		float cosOuterAngle;
+		float cosInnerAngle;
+		float padding[3];
+	};
+
+	//Inverse square with a window that takes it smoothly to 0 at range. Same as localLightFalloff in shaders/lighting.glsl
+	inline float getLocalLightFalloff(float distance, float range) {
+		float ratio = distance / range;
+		float window = glm::clamp(1.0f - ratio * ratio * ratio * ratio, 0.0f, 1.0f);
+		return window * window / std::max(distance * distance, 0.01f);
+	}
+
+	/// <summary>
+	/// Forward lighting with many local lights. Every light goes into one uniform buffer, and each object gets
+	/// the few lights with the most influence on its bounds. A list is packed into a 64 bit key, 16 bits per light
+	/// in increasing order with 0xffff unused, so objects with the same lights compare equal and their draws can be merged
+	/// </summary>
+	class LightLists {
+	public:
+		LightLists();
+		~LightLists();
+		//Up to MAX_LIGHTS, uploaded right away
+		void setLights(const std::vector<LocalLight>& lights);
+		//Binds the light buffer to the LocalLights block's binding
+		void bind()const;
+		//Picks the lights for objects[0...count), bounds indexed by object id. Lights that miss the frustum are skipped
+		//up front, since whatever they reach isn't on screen. The rest go into a grid on the XZ plane, so each object only
+		//tests the lights of the cells it covers. Results are read with getKey
+		void assign(const glm::vec3* boundsMin, const glm::vec3* boundsMax, const int* objects, int count, const FrustumPlanes& planes, bool parallel = true);
+		//Key of an object passed to the last assign
+		inline uint64_t getKey(int object)const { return mKeys[object]; }
+		inline const uint64_t* getKeys()const { return mKeys.data(); }
+		inline int getLightCount()const { return (int)mLights.size(); }
+		//Lights that passed the frustum test in the last assign
+		inline int getVisibleLightCount()const { return (int)mVisibleLights.size(); }
+		//Sum of list lengths over the objects of the last assign
+		inline int getLastAssignedCount()const { return mLastAssignedCount; }
+
+		//Light index of slot 0 to MAX_LIGHTS_PER_OBJECT - 1, -1 if unused
+		static inline int getKeyLight(uint64_t key, int slot) {
+			int light = (int)((key >> (slot * 16)) & 0xffff);
+			return light == 0xffff ? -1 : light;
+		}
+		static constexpr uint64_t EMPTY_KEY = ~0ull;
+		//Match MAX_LOCAL_LIGHTS and MAX_OBJECT_LIGHTS in shaders/lighting.glsl. 256 lights are 16KB, the smallest
+		//uniform block size GL guarantees
+		static constexpr int MAX_LIGHTS = 256;
+		static constexpr int MAX_LIGHTS_PER_OBJECT = 4;
+		static constexpr GLuint UNIFORM_BINDING = 0;
+		//Per side, cells grow past the largest light's diameter when the lights are spread wider than this
+		static constexpr int MAX_GRID_CELLS = 64;
+	private:
+		LightLists(const LightLists& r) = delete;
+		void buildGrid();
+		inline glm::ivec2 getCell(const glm::vec2& p)const {
+			glm::ivec2 cell = glm::ivec2(glm::floor((p - mGridMin) / mCellSize));
+			return glm::clamp(cell, glm::ivec2(0), glm::ivec2(mGridWidth - 1, mGridHeight - 1));
+		}
+		//How much of the light can reach the box, 0 if none
+		float getInfluence(const LocalLight& light, const glm::vec3& boundsMin, const glm::vec3& boundsMax)const;
+
+		GLuint mUBO;
+		std::vector<LocalLight> mLights;
+		std::vector<int> mVisibleLights;
+		//Visible lights by cell: mCellLights[mCellStarts[cell]...mCellStarts[cell + 1])
+		glm::vec2 mGridMin = glm::vec2(0), mGridMax = glm::vec2(0);
+		float mCellSize = 1.0f;
+		int mGridWidth = 1, mGridHeight = 1;
+		std::vector<int> mCellStarts;
+		std::vector<int> mCellLights;
+		std::vector<uint64_t> mKeys;
+		int mLastAssignedCount = 0;
+	};
+}
@@ -2,18 +2,20 @@
 
 #include "Mesh.h"
 namespace ew {
-	Mesh::Mesh(MeshData* meshData) {
+	Mesh::Mesh(MeshData* meshData) : Mesh(MeshDataView(*meshData)) {}
+
+	Mesh::Mesh(const MeshDataView& meshData) {
 
 		glGenVertexArrays(1, &mVAO);
 		glBindVertexArray(mVAO);
 
 		glGenBuffers(1, &mVBO);
 		glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-		glBufferData(GL_ARRAY_BUFFER, meshData->vertices.size() * sizeof(Vertex), &meshData->vertices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, meshData.numVertices * sizeof(Vertex), meshData.vertices, GL_STATIC_DRAW);
 
 		glGenBuffers(1, &mEBO);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshData->indices.size() * sizeof(unsigned int), &meshData->indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshData.numIndices * sizeof(unsigned int), meshData.indices, GL_STATIC_DRAW);
 
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, position)));
 		glEnableVertexAttribArray(0);
@@ -24,8 +26,11 @@ namespace ew {
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, UV)));
 		glEnableVertexAttribArray(2);
 
-		mNumIndices = (GLsizei)meshData->indices.size();
-		mNumVertices = (GLsizei)meshData->vertices.size();
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, tangent)));
+		glEnableVertexAttribArray(3);
+
+		mNumIndices = (GLsizei)meshData.numIndices;
+		mNumVertices = (GLsizei)meshData.numVertices;
 	}
 
 	Mesh::~Mesh()
@@ -41,4 +46,27 @@ namespace ew {
 		glDrawElements(GL_TRIANGLES, mNumIndices, GL_UNSIGNED_INT, 0);
 	}
 
+	void Mesh::bind()
+	{
+		glBindVertexArray(mVAO);
+	}
+
+	void Mesh::drawBound()
+	{
+		glDrawElements(GL_TRIANGLES, mNumIndices, GL_UNSIGNED_INT, 0);
+	}
+
+	void Mesh::drawRange(unsigned int firstIndex, GLsizei indexCount)
+	{
+		glBindVertexArray(mVAO);
+		glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (const void*)(firstIndex * sizeof(unsigned int)));
+	}
+
+	void Mesh::drawPatches()
+	{
+		glBindVertexArray(mVAO);
+		glPatchParameteri(GL_PATCH_VERTICES, 3);
+		glDrawElements(GL_PATCHES, mNumIndices, GL_UNSIGNED_INT, 0);
+	}
+
 }
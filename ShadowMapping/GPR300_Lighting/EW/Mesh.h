@@ -4,14 +4,17 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <vector>
+#include <array>
 
 namespace ew {
 	struct Vertex {
 		glm::vec3 position;
 		glm::vec3 normal;
 		glm::vec2 UV;
-		Vertex(glm::vec3 position, glm::vec3 normal, glm::vec2 UV)
-			: position(position), normal(normal), UV(UV) {};
+		glm::vec4 tangent; //w is the bitangent sign, bitangent = cross(normal, tangent.xyz) * w
+		Vertex() {};
+		constexpr Vertex(glm::vec3 position, glm::vec3 normal, glm::vec2 UV, glm::vec3 tangent, float bitangentSign = 1.0f)
+			: position(position), normal(normal), UV(UV), tangent(tangent, bitangentSign) {};
 	};
 
 	/// <summary>
@@ -22,14 +25,49 @@ namespace ew {
 		std::vector<unsigned int> indices;
 	};
 
+	/// <summary>
+	/// Fixed size vertex + face data that can be built at compile time, see makeCube in ShapeGen.h
+	/// </summary>
+	template<size_t NumVertices, size_t NumIndices>
+	struct StaticMeshData {
+		std::array<Vertex, NumVertices> vertices;
+		std::array<unsigned int, NumIndices> indices;
+	};
+
+	/// <summary>
+	/// Non owning pointer + count view of a MeshData or StaticMeshData
+	/// </summary>
+	struct MeshDataView {
+		const Vertex* vertices;
+		size_t numVertices;
+		const unsigned int* indices;
+		size_t numIndices;
+		MeshDataView(const MeshData& meshData)
+			: vertices(meshData.vertices.data()), numVertices(meshData.vertices.size()), indices(meshData.indices.data()), numIndices(meshData.indices.size()) {};
+		template<size_t NumVertices, size_t NumIndices>
+		MeshDataView(const StaticMeshData<NumVertices, NumIndices>& meshData)
+			: vertices(meshData.vertices.data()), numVertices(NumVertices), indices(meshData.indices.data()), numIndices(NumIndices) {};
+	};
+
 	/// <summary>
 	/// Holds OpenGL buffers, can be drawn
 	/// </summary>
 	class Mesh {
 	public:
 		Mesh(MeshData* meshData);
+		//Uploads straight from the viewed data, no copies
+		Mesh(const MeshDataView& meshData);
 		~Mesh();
 		void draw();
+		//Binds the VAO, then drawBound draws without binding it again. For callers that skip redundant binds
+		void bind();
+		void drawBound();
+		//Draws a sub range of the index buffer
+		void drawRange(unsigned int firstIndex, GLsizei indexCount);
+		//Draws every triangle as a 3 vertex patch, for tessellation shaders
+		void drawPatches();
+		inline GLsizei getNumIndices()const { return mNumIndices; }
+		inline GLsizei getNumVertices()const { return mNumVertices; }
 	private:
 		GLuint mVAO, mVBO, mEBO;
 		GLsizei mNumIndices;
@@ -0,0 +1,169 @@
+#include "MeshCache.h"
+#include "ShapeGen.h"
+#include <string.h>
+
+namespace ew {
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+	const uint64_t FNV_PRIME = 1099511628211ull;
+
+	static uint64_t hashBytes(uint64_t hash, const void* data, size_t numBytes)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		size_t numWords = numBytes / 8;
+		for (size_t i = 0; i < numWords; i++) {
+			uint64_t word;
+			memcpy(&word, bytes + i * 8, 8);
+			hash = (hash ^ word) * FNV_PRIME;
+		}
+		for (size_t i = numWords * 8; i < numBytes; i++) {
+			hash = (hash ^ bytes[i]) * FNV_PRIME;
+		}
+		return hash;
+	}
+
+	uint64_t hashMeshData(const MeshDataView& meshData)
+	{
+		//Counts go in first so a vertex/index split at a different point can't collide
+		uint64_t counts[2] = { meshData.numVertices, meshData.numIndices };
+		uint64_t hash = hashBytes(FNV_OFFSET_BASIS, counts, sizeof(counts));
+		hash = hashBytes(hash, meshData.vertices, meshData.numVertices * sizeof(Vertex));
+		return hashBytes(hash, meshData.indices, meshData.numIndices * sizeof(unsigned int));
+	}
+
+	bool ShapeDesc::operator==(const ShapeDesc& other)const
+	{
+		//Bitwise like ShapeDescHash, so 0 and -0 are different keys and NaN params still find their entry
+		return type == other.type && detail == other.detail && memcmp(params, other.params, sizeof(params)) == 0;
+	}
+
+	size_t ShapeDescHash::operator()(const ShapeDesc& desc)const
+	{
+		int type = (int)desc.type;
+		uint64_t hash = hashBytes(FNV_OFFSET_BASIS, &type, sizeof(type));
+		hash = hashBytes(hash, desc.params, sizeof(desc.params));
+		return (size_t)hashBytes(hash, &desc.detail, sizeof(desc.detail));
+	}
+
+	std::shared_ptr<Mesh> MeshCache::getMesh(const ShapeDesc& desc)
+	{
+		std::shared_ptr<Mesh> mesh = mShapeMeshes[desc].lock();
+		if (mesh) {
+			mHits++;
+			return mesh;
+		}
+		//Reuses the CPU data if someone is still holding it. That's a hit, the shape isn't generated again
+		std::shared_ptr<const MeshData> meshData = mShapeData[desc].lock();
+		if (meshData) {
+			mHits++;
+		}
+		else {
+			meshData = createMeshData(desc);
+			mMisses++;
+		}
+		mesh = std::make_shared<Mesh>(MeshDataView(*meshData));
+		mShapeMeshes[desc] = mesh;
+		return mesh;
+	}
+
+	std::shared_ptr<Mesh> MeshCache::getMesh(const MeshDataView& meshData)
+	{
+		uint64_t hash = hashMeshData(meshData);
+		//The hash only narrows it down, a hit has to have the same bytes too
+		auto range = mContentMeshes.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			ContentEntry& entry = it->second;
+			if (entry.data.vertices.size() != meshData.numVertices || entry.data.indices.size() != meshData.numIndices
+				|| memcmp(entry.data.vertices.data(), meshData.vertices, meshData.numVertices * sizeof(Vertex)) != 0
+				|| memcmp(entry.data.indices.data(), meshData.indices, meshData.numIndices * sizeof(unsigned int)) != 0) {
+				continue;
+			}
+			//Known content, rebuilt if its mesh was released
+			mHits++;
+			std::shared_ptr<Mesh> mesh = entry.mesh.lock();
+			if (!mesh) {
+				mesh = std::make_shared<Mesh>(meshData);
+				entry.mesh = mesh;
+			}
+			return mesh;
+		}
+		ContentEntry entry;
+		entry.data.vertices.assign(meshData.vertices, meshData.vertices + meshData.numVertices);
+		entry.data.indices.assign(meshData.indices, meshData.indices + meshData.numIndices);
+		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(meshData);
+		entry.mesh = mesh;
+		mContentMeshes.emplace(hash, std::move(entry));
+		mMisses++;
+		return mesh;
+	}
+
+	std::shared_ptr<Mesh> MeshCache::getStaticMesh(const void* key, const MeshDataView& meshData)
+	{
+		std::shared_ptr<Mesh> mesh = mStaticMeshes[key].lock();
+		if (mesh) {
+			mHits++;
+			return mesh;
+		}
+		mesh = std::make_shared<Mesh>(meshData);
+		mStaticMeshes[key] = mesh;
+		mMisses++;
+		return mesh;
+	}
+
+	std::shared_ptr<const MeshData> MeshCache::getMeshData(const ShapeDesc& desc)
+	{
+		std::shared_ptr<const MeshData> cached = mShapeData[desc].lock();
+		if (cached) {
+			mHits++;
+			return cached;
+		}
+		mMisses++;
+		return createMeshData(desc);
+	}
+
+	std::shared_ptr<const MeshData> MeshCache::createMeshData(const ShapeDesc& desc)
+	{
+		std::shared_ptr<MeshData> meshData = std::make_shared<MeshData>();
+		switch (desc.type)
+		{
+		case ShapeType::Plane:
+			createPlane(desc.params[0], desc.params[1], *meshData);
+			break;
+		case ShapeType::Quad:
+			createQuad(desc.params[0], desc.params[1], *meshData);
+			break;
+		case ShapeType::Cube:
+			createCube(desc.params[0], desc.params[1], desc.params[2], *meshData);
+			break;
+		case ShapeType::Sphere:
+			createSphere(desc.params[0], desc.detail, *meshData);
+			break;
+		case ShapeType::Cylinder:
+			createCylinder(desc.params[0], desc.params[1], desc.detail, *meshData);
+			break;
+		case ShapeType::Icosphere:
+			createIcosphere(desc.params[0], desc.detail, *meshData);
+			break;
+		case ShapeType::CubeSphere:
+			createCubeSphere(desc.params[0], desc.detail, *meshData);
+			break;
+		}
+		mShapeData[desc] = meshData;
+		return meshData;
+	}
+
+	void MeshCache::collect()
+	{
+		for (auto it = mShapeMeshes.begin(); it != mShapeMeshes.end();) {
+			it = it->second.expired() ? mShapeMeshes.erase(it) : ++it;
+		}
+		for (auto it = mContentMeshes.begin(); it != mContentMeshes.end();) {
+			it = it->second.mesh.expired() ? mContentMeshes.erase(it) : ++it;
+		}
+		for (auto it = mStaticMeshes.begin(); it != mStaticMeshes.end();) {
+			it = it->second.expired() ? mStaticMeshes.erase(it) : ++it;
+		}
+		for (auto it = mShapeData.begin(); it != mShapeData.end();) {
+			it = it->second.expired() ? mShapeData.erase(it) : ++it;
+		}
+	}
+}
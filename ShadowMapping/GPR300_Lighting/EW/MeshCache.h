@@ -0,0 +1,88 @@
+#pragma once
+#include "Mesh.h"
+#include <memory>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace ew {
+	enum class ShapeType {
+		Plane,
+		Quad,
+		Cube,
+		Sphere,
+		Cylinder,
+		Icosphere,
+		CubeSphere
+	};
+
+	/// <summary>
+	/// ShapeGen generator + its parameters. Two equal descs always generate identical mesh data
+	/// </summary>
+	struct ShapeDesc {
+		ShapeType type;
+		float params[3];
+		int detail;
+
+		static ShapeDesc plane(float width, float height) { return { ShapeType::Plane, { width, height, 0 }, 0 }; }
+		static ShapeDesc quad(float width, float height) { return { ShapeType::Quad, { width, height, 0 }, 0 }; }
+		static ShapeDesc cube(float width, float height, float depth) { return { ShapeType::Cube, { width, height, depth }, 0 }; }
+		static ShapeDesc sphere(float radius, int numSegments) { return { ShapeType::Sphere, { radius, 0, 0 }, numSegments }; }
+		static ShapeDesc cylinder(float height, float radius, int numSegments) { return { ShapeType::Cylinder, { height, radius, 0 }, numSegments }; }
+		static ShapeDesc icosphere(float radius, int subdivisions) { return { ShapeType::Icosphere, { radius, 0, 0 }, subdivisions }; }
+		static ShapeDesc cubeSphere(float radius, int resolution) { return { ShapeType::CubeSphere, { radius, 0, 0 }, resolution }; }
+
+		//Params are compared bit for bit
+		bool operator==(const ShapeDesc& other)const;
+	};
+
+	struct ShapeDescHash {
+		size_t operator()(const ShapeDesc& desc)const;
+	};
+
+	/// <summary>
+	/// Hands out shared meshes so identical geometry is only generated and uploaded once.
+	/// Lookups are keyed by ShapeDesc, by address for compile time StaticMeshData, or by a content hash for mesh
+	/// data built elsewhere at runtime. A miss is geometry generated or seen for the first time, a hit is geometry
+	/// the cache already had, even if its GPU mesh had been released and is built again.
+	/// The cache only holds weak references, a mesh is freed as soon as the last user lets go of it.
+	/// Main thread only, since it creates GL objects.
+	/// </summary>
+	class MeshCache {
+	public:
+		std::shared_ptr<Mesh> getMesh(const ShapeDesc& desc);
+		//Keyed by a 64 bit hash of the vertex + index bytes. Entries keep a copy of the data to compare on a hash match
+		std::shared_ptr<Mesh> getMesh(const MeshDataView& meshData);
+		//Static data never moves or changes, so its address is the key: no hashing and no copy
+		template<size_t NumVertices, size_t NumIndices>
+		std::shared_ptr<Mesh> getMesh(const StaticMeshData<NumVertices, NumIndices>& meshData) {
+			return getStaticMesh(&meshData, MeshDataView(meshData));
+		}
+		//CPU side data for a shape, for things like static batching that need the vertices
+		std::shared_ptr<const MeshData> getMeshData(const ShapeDesc& desc);
+		//Drops entries whose meshes have all been released
+		void collect();
+
+		inline int getHitCount()const { return mHits; }
+		inline int getMissCount()const { return mMisses; }
+		inline int getEntryCount()const { return (int)(mShapeMeshes.size() + mContentMeshes.size() + mStaticMeshes.size() + mShapeData.size()); }
+	private:
+		struct ContentEntry {
+			MeshData data;
+			std::weak_ptr<Mesh> mesh;
+		};
+		//Generates and caches a shape's data. Doesn't count, each public lookup counts once
+		std::shared_ptr<const MeshData> createMeshData(const ShapeDesc& desc);
+		std::shared_ptr<Mesh> getStaticMesh(const void* key, const MeshDataView& meshData);
+
+		std::unordered_map<ShapeDesc, std::weak_ptr<Mesh>, ShapeDescHash> mShapeMeshes;
+		//Multimap so meshes whose hashes collide each keep their own entry
+		std::unordered_multimap<uint64_t, ContentEntry> mContentMeshes;
+		std::unordered_map<const void*, std::weak_ptr<Mesh>> mStaticMeshes;
+		std::unordered_map<ShapeDesc, std::weak_ptr<const MeshData>, ShapeDescHash> mShapeData;
+		int mHits = 0;
+		int mMisses = 0;
+	};
+
+	//64 bit FNV-1a style hash of the vertex and index bytes, 8 bytes at a time
+	uint64_t hashMeshData(const MeshDataView& meshData);
+}
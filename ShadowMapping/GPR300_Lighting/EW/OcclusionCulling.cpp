@@ -0,0 +1,268 @@
+#include "OcclusionCulling.h"
+#include "SimdMath.h"
+#include "Parallel.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <assert.h>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+namespace ew {
+	//Triangles with a vertex closer than this in w are treated as crossing the near plane
+	const float MIN_W = 1e-5f;
+	const uint32_t FULL_TILE = 0xffffffffu;
+
+	OcclusionCuller::OcclusionCuller(int width, int height)
+		: mWidth(width), mHeight(height), mTilesX(width / TILE_WIDTH), mTilesY(height / TILE_HEIGHT)
+	{
+		assert(width % TILE_WIDTH == 0 && height % TILE_HEIGHT == 0);
+		mTileDepth.resize(mTilesX * mTilesY);
+		mTileMaskDepth.resize(mTilesX * mTilesY);
+		mTileMask.resize(mTilesX * mTilesY);
+	}
+
+	void OcclusionCuller::beginFrame(const glm::mat4& viewProjection)
+	{
+		mViewProjection = viewProjection;
+		mOccluders.clear();
+		mOccluderIds.clear();
+		mTriangles.clear();
+		mRasterizedTriangleCount = 0;
+		std::fill(mTileDepth.begin(), mTileDepth.end(), 1.0f);
+		std::fill(mTileMaskDepth.begin(), mTileMaskDepth.end(), 0.0f);
+		std::fill(mTileMask.begin(), mTileMask.end(), 0u);
+	}
+
+	void OcclusionCuller::addOccluder(const MeshDataView& meshData, const glm::mat4& model, int id)
+	{
+		int firstTriangle = mOccluders.empty() ? 0 : mOccluders.back().firstTriangle + (int)mOccluders.back().meshData.numIndices / 3;
+		mOccluders.push_back({ meshData, model, firstTriangle });
+		if (id >= 0) {
+			mOccluderIds.push_back(id);
+		}
+	}
+
+	void OcclusionCuller::setupTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2, ScreenTriangle& out)const
+	{
+		//Rejected triangles keep an empty tile range
+		out.tileMinX = out.tileMinY = 0;
+		out.tileMaxX = out.tileMaxY = -1;
+		const glm::vec4* clip[3] = { &clip0, &clip1, &clip2 };
+		glm::vec3 screen[3];
+		for (int i = 0; i < 3; i++) {
+			const glm::vec4& c = *clip[i];
+			if (c.w < MIN_W || c.z < -c.w) {
+				return;
+			}
+			float invW = 1.0f / c.w;
+			screen[i] = glm::vec3((c.x * invW * 0.5f + 0.5f) * mWidth, (c.y * invW * 0.5f + 0.5f) * mHeight, c.z * invW * 0.5f + 0.5f);
+		}
+		glm::vec2 e1 = glm::vec2(screen[1] - screen[0]);
+		glm::vec2 e2 = glm::vec2(screen[2] - screen[0]);
+		float area = e1.x * e2.y - e2.x * e1.y;
+		//Back facing or degenerate
+		if (area <= 0.0f) {
+			return;
+		}
+		float minX = std::min(screen[0].x, std::min(screen[1].x, screen[2].x));
+		float maxX = std::max(screen[0].x, std::max(screen[1].x, screen[2].x));
+		float minY = std::min(screen[0].y, std::min(screen[1].y, screen[2].y));
+		float maxY = std::max(screen[0].y, std::max(screen[1].y, screen[2].y));
+		if (maxX <= 0.0f || maxY <= 0.0f || minX >= mWidth || minY >= mHeight) {
+			return;
+		}
+
+		//Edge a -> b is A * x + B * y + C, negative inside a counter clockwise triangle
+		for (int i = 0; i < 3; i++) {
+			const glm::vec3& a = screen[i];
+			const glm::vec3& b = screen[(i + 1) % 3];
+			out.edgeA[i] = b.y - a.y;
+			out.edgeB[i] = a.x - b.x;
+			out.edgeC[i] = -(out.edgeA[i] * a.x + out.edgeB[i] * a.y);
+		}
+		//Depth plane z = depthA * x + depthB * y + depthC
+		float dz1 = screen[1].z - screen[0].z;
+		float dz2 = screen[2].z - screen[0].z;
+		out.depthA = (dz1 * e2.y - dz2 * e1.y) / area;
+		out.depthB = (dz2 * e1.x - dz1 * e2.x) / area;
+		out.depthC = screen[0].z - out.depthA * screen[0].x - out.depthB * screen[0].y;
+		out.maxDepth = std::min(1.0f, std::max(screen[0].z, std::max(screen[1].z, screen[2].z)));
+
+		out.tileMinX = std::max(0, (int)minX / TILE_WIDTH);
+		out.tileMinY = std::max(0, (int)minY / TILE_HEIGHT);
+		out.tileMaxX = std::min(mTilesX - 1, (int)maxX / TILE_WIDTH);
+		out.tileMaxY = std::min(mTilesY - 1, (int)maxY / TILE_HEIGHT);
+	}
+
+	void OcclusionCuller::updateTile(int tile, uint32_t coverage, float depth)
+	{
+		if (depth >= mTileDepth[tile]) {
+			return;
+		}
+		//If the new triangle is much closer than the working layer, the layer is mostly far stuff that would only
+		//make the merged depth worse. Start a new layer instead (Andersson et al., Masked Software Occlusion Culling)
+		float layerDistance = mTileMaskDepth[tile] - depth;
+		float tileDistance = mTileDepth[tile] - mTileMaskDepth[tile];
+		if (layerDistance > tileDistance) {
+			mTileMask[tile] = 0;
+			mTileMaskDepth[tile] = 0.0f;
+		}
+		mTileMask[tile] |= coverage;
+		mTileMaskDepth[tile] = std::max(mTileMaskDepth[tile], depth);
+		if (mTileMask[tile] == FULL_TILE) {
+			mTileDepth[tile] = mTileMaskDepth[tile];
+			mTileMask[tile] = 0;
+			mTileMaskDepth[tile] = 0.0f;
+		}
+	}
+
+	void OcclusionCuller::rasterizeTriangle(const ScreenTriangle& triangle, int tileRowBegin, int tileRowEnd)
+	{
+		int tileMinY = std::max(triangle.tileMinY, tileRowBegin);
+		int tileMaxY = std::min(triangle.tileMaxY, tileRowEnd - 1);
+#if defined(__AVX2__)
+		//One row of a tile per register
+		__m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+		__m256 edgeA[3];
+		for (int i = 0; i < 3; i++) {
+			edgeA[i] = _mm256_set1_ps(triangle.edgeA[i]);
+		}
+#else
+		//Half a row per register
+		__m128 laneOffsets[2] = { _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f), _mm_setr_ps(4.5f, 5.5f, 6.5f, 7.5f) };
+		__m128 edgeA[3];
+		for (int i = 0; i < 3; i++) {
+			edgeA[i] = _mm_set1_ps(triangle.edgeA[i]);
+		}
+#endif
+		for (int tileY = tileMinY; tileY <= tileMaxY; tileY++) {
+			for (int tileX = triangle.tileMinX; tileX <= triangle.tileMaxX; tileX++) {
+				float x = (float)(tileX * TILE_WIDTH);
+				uint32_t coverage = 0;
+				for (int row = 0; row < TILE_HEIGHT; row++) {
+					float y = tileY * TILE_HEIGHT + row + 0.5f;
+#if defined(__AVX2__)
+					__m256 xs = _mm256_add_ps(_mm256_set1_ps(x), laneOffsets);
+					__m256 inside = _mm256_set1_ps(-FLT_MAX);
+					for (int i = 0; i < 3; i++) {
+						__m256 edge = _mm256_add_ps(_mm256_mul_ps(edgeA[i], xs), _mm256_set1_ps(triangle.edgeB[i] * y + triangle.edgeC[i]));
+						inside = _mm256_max_ps(inside, edge);
+					}
+					//Sign bit set where every edge is negative
+					coverage |= (uint32_t)_mm256_movemask_ps(inside) << (row * TILE_WIDTH);
+#else
+					for (int half = 0; half < 2; half++) {
+						__m128 xs = _mm_add_ps(_mm_set1_ps(x), laneOffsets[half]);
+						__m128 inside = _mm_set1_ps(-FLT_MAX);
+						for (int i = 0; i < 3; i++) {
+							__m128 edge = _mm_add_ps(_mm_mul_ps(edgeA[i], xs), _mm_set1_ps(triangle.edgeB[i] * y + triangle.edgeC[i]));
+							inside = _mm_max_ps(inside, edge);
+						}
+						coverage |= (uint32_t)_mm_movemask_ps(inside) << (row * TILE_WIDTH + half * 4);
+					}
+#endif
+				}
+				if (coverage == 0) {
+					continue;
+				}
+				//The plane is linear, so its farthest point over the tile's samples is at a corner
+				float x0 = x + 0.5f, x1 = x + TILE_WIDTH - 0.5f;
+				float y0 = tileY * TILE_HEIGHT + 0.5f, y1 = y0 + TILE_HEIGHT - 1.0f;
+				float depth = triangle.depthC + std::max(triangle.depthA * x0, triangle.depthA * x1) + std::max(triangle.depthB * y0, triangle.depthB * y1);
+				updateTile(tileY * mTilesX + tileX, coverage, std::min(depth, triangle.maxDepth));
+			}
+		}
+	}
+
+	void OcclusionCuller::rasterize(bool parallel)
+	{
+		int numTriangles = mOccluders.empty() ? 0 : mOccluders.back().firstTriangle + (int)mOccluders.back().meshData.numIndices / 3;
+		mTriangles.resize(numTriangles);
+		std::sort(mOccluderIds.begin(), mOccluderIds.end());
+
+		//Every occluder writes its own slice, so setup order (and the result) doesn't depend on threading
+		parallelFor((int)mOccluders.size(), parallel ? 4 : INT_MAX, [&](int begin, int end) {
+			std::vector<glm::vec4> clip;
+			for (int o = begin; o < end; o++) {
+				const Occluder& occluder = mOccluders[o];
+				glm::mat4 modelViewProjection = mulMat4(mViewProjection, occluder.model);
+				clip.resize(occluder.meshData.numVertices);
+				for (size_t i = 0; i < occluder.meshData.numVertices; i++) {
+					clip[i] = mulMat4Vec4(modelViewProjection, glm::vec4(occluder.meshData.vertices[i].position, 1.0f));
+				}
+				const unsigned int* indices = occluder.meshData.indices;
+				int numOccluderTriangles = (int)occluder.meshData.numIndices / 3;
+				for (int t = 0; t < numOccluderTriangles; t++) {
+					setupTriangle(clip[indices[t * 3]], clip[indices[t * 3 + 1]], clip[indices[t * 3 + 2]], mTriangles[occluder.firstTriangle + t]);
+				}
+			}
+		});
+
+		mRasterizedTriangleCount = 0;
+		for (const ScreenTriangle& triangle : mTriangles) {
+			mRasterizedTriangleCount += triangle.tileMaxY >= triangle.tileMinY;
+		}
+		//Each worker owns a band of tile rows and walks every triangle in submission order
+		parallelFor(mTilesY, parallel ? 2 : INT_MAX, [&](int tileRowBegin, int tileRowEnd) {
+			for (const ScreenTriangle& triangle : mTriangles) {
+				if (triangle.tileMaxY >= tileRowBegin && triangle.tileMinY < tileRowEnd) {
+					rasterizeTriangle(triangle, tileRowBegin, tileRowEnd);
+				}
+			}
+		});
+	}
+
+	bool OcclusionCuller::isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax)const
+	{
+		glm::vec2 screenMin = glm::vec2(FLT_MAX), screenMax = glm::vec2(-FLT_MAX);
+		float nearestDepth = FLT_MAX;
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec3 p = glm::vec3(corner & 1 ? boundsMax.x : boundsMin.x, corner & 2 ? boundsMax.y : boundsMin.y, corner & 4 ? boundsMax.z : boundsMin.z);
+			glm::vec4 clip = mulMat4Vec4(mViewProjection, glm::vec4(p, 1.0f));
+			//Reaches the camera plane, screen bounds aren't meaningful
+			if (clip.w < MIN_W || clip.z < -clip.w) {
+				return true;
+			}
+			float invW = 1.0f / clip.w;
+			glm::vec2 screen = glm::vec2((clip.x * invW * 0.5f + 0.5f) * mWidth, (clip.y * invW * 0.5f + 0.5f) * mHeight);
+			screenMin = glm::min(screenMin, screen);
+			screenMax = glm::max(screenMax, screen);
+			nearestDepth = std::min(nearestDepth, clip.z * invW * 0.5f + 0.5f);
+		}
+		int tileMinX = std::max(0, (int)floorf(screenMin.x) / TILE_WIDTH);
+		int tileMinY = std::max(0, (int)floorf(screenMin.y) / TILE_HEIGHT);
+		int tileMaxX = std::min(mTilesX - 1, (int)floorf(screenMax.x) / TILE_WIDTH);
+		int tileMaxY = std::min(mTilesY - 1, (int)floorf(screenMax.y) / TILE_HEIGHT);
+		//Off screen is frustum culling's call
+		if (tileMinX > tileMaxX || tileMinY > tileMaxY || screenMax.x < 0.0f || screenMax.y < 0.0f) {
+			return true;
+		}
+		for (int tileY = tileMinY; tileY <= tileMaxY; tileY++) {
+			const float* depths = &mTileDepth[tileY * mTilesX];
+			for (int tileX = tileMinX; tileX <= tileMaxX; tileX++) {
+				if (nearestDepth < depths[tileX]) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void OcclusionCuller::removeOccluded(const glm::vec3* boundsMin, const glm::vec3* boundsMax, std::vector<int>& ids, bool parallel)const
+	{
+		std::vector<unsigned char> visible(ids.size());
+		parallelFor((int)ids.size(), parallel ? 1024 : INT_MAX, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				visible[i] = std::binary_search(mOccluderIds.begin(), mOccluderIds.end(), ids[i]) || isVisible(boundsMin[ids[i]], boundsMax[ids[i]]);
+			}
+		});
+		int numVisible = 0;
+		for (size_t i = 0; i < ids.size(); i++) {
+			if (visible[i]) {
+				ids[numVisible++] = ids[i];
+			}
+		}
+		ids.resize(numVisible);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Mesh.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace ew {
+	/// <summary>
+	/// CPU occlusion culling. Occluder meshes are rasterized with SIMD into a small depth buffer, which occludee
+	/// bounds are then tested against before drawing. No GPU involved, so results are ready the same frame and
+	/// identical from run to run.
+	/// The buffer is made of 8x4 pixel tiles. Instead of per pixel depth, a tile keeps a 32 bit coverage mask with
+	/// the farthest depth of the triangles that set it, and one conservative far depth for the whole tile.
+	/// Once the mask fills up it becomes the new whole-tile depth. Occludees are tested a tile at a time.
+	/// Coverage is computed a tile row (8 pixels) per instruction in the project's AVX2 build, half a row with SSE only.
+	/// Depth is GL NDC depth mapped to [0, 1], 1 is the far plane
+	/// </summary>
+	class OcclusionCuller {
+	public:
+		//Width has to be a multiple of 8 and height a multiple of 4
+		OcclusionCuller(int width = 256, int height = 128);
+		//Clears the buffer and drops last frame's occluders
+		void beginFrame(const glm::mat4& viewProjection);
+		//meshData has to stay alive until rasterize. Back faces and triangles crossing the near plane are skipped,
+		//which only ever makes occluders smaller. id is the occluder's id in removeOccluded, -1 if it isn't tested
+		void addOccluder(const MeshDataView& meshData, const glm::mat4& model, int id = -1);
+		//Transforms and rasterizes every occluder, tile rows split across worker threads
+		void rasterize(bool parallel = true);
+
+		//False only if the box is hidden behind occluders everywhere it covers on screen. An occluder's own bounds can
+		//test as hidden behind its front faces, so occluders shouldn't be tested
+		bool isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax)const;
+		//Removes hidden ids from ids, keeping the order. Bounds are indexed by id. Occluders are never removed: their
+		//own depth is in the buffer, so one filling the screen would test as hidden behind itself
+		void removeOccluded(const glm::vec3* boundsMin, const glm::vec3* boundsMax, std::vector<int>& ids, bool parallel = true)const;
+
+		inline int getWidth()const { return mWidth; }
+		inline int getHeight()const { return mHeight; }
+		inline int getOccluderCount()const { return (int)mOccluders.size(); }
+		inline int getRasterizedTriangleCount()const { return mRasterizedTriangleCount; }
+		//Conservative depth of a whole tile, for debugging
+		inline float getTileDepth(int tileX, int tileY)const { return mTileDepth[tileY * mTilesX + tileX]; }
+
+		static constexpr int TILE_WIDTH = 8;
+		static constexpr int TILE_HEIGHT = 4;
+	private:
+		OcclusionCuller(const OcclusionCuller& r) = delete;
+
+		struct Occluder {
+			MeshDataView meshData;
+			glm::mat4 model;
+			int firstTriangle;
+		};
+		//Screen space triangle ready for edge functions. Empty tile range if it was rejected
+		struct ScreenTriangle {
+			float edgeA[3], edgeB[3], edgeC[3];
+			float depthA, depthB, depthC;
+			float maxDepth;
+			int tileMinX, tileMinY, tileMaxX, tileMaxY;
+		};
+
+		void setupTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2, ScreenTriangle& out)const;
+		void rasterizeTriangle(const ScreenTriangle& triangle, int tileRowBegin, int tileRowEnd);
+		void updateTile(int tile, uint32_t coverage, float depth);
+
+		int mWidth, mHeight;
+		int mTilesX, mTilesY;
+		glm::mat4 mViewProjection = glm::mat4(1);
+		std::vector<Occluder> mOccluders;
+		//Ids passed to addOccluder, sorted by rasterize
+		std::vector<int> mOccluderIds;
+		std::vector<ScreenTriangle> mTriangles;
+		int mRasterizedTriangleCount = 0;
+		//Per tile: whole tile far depth, working layer far depth, working layer coverage
+		std::vector<float> mTileDepth;
+		std::vector<float> mTileMaskDepth;
+		std::vector<uint32_t> mTileMask;
+	};
+}
@@ -0,0 +1,82 @@
+#include "OcclusionQueries.h"
+#include "ShapeGen.h"
+#include "SimdMath.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace ew {
+	OcclusionQueries::OcclusionQueries()
+	{
+		MeshData boxMeshData;
+		createCube(1.0f, 1.0f, 1.0f, boxMeshData);
+		mBoxMesh = new Mesh(&boxMeshData);
+	}
+
+	OcclusionQueries::~OcclusionQueries()
+	{
+		delete mBoxMesh;
+		if (!mQueries.empty()) {
+			glDeleteQueries((GLsizei)mQueries.size(), mQueries.data());
+		}
+	}
+
+	void OcclusionQueries::beginFrame(Shader* boxShader, const glm::mat4& viewProjection)
+	{
+		mBoxShader = boxShader;
+		mViewProjection = viewProjection;
+		mLastOccludedCount = 0;
+		mLastResolvedCount = 0;
+		for (int object : mIssued) {
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(mQueries[object], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint anySamplesPassed;
+				glGetQueryObjectuiv(mQueries[object], GL_QUERY_RESULT, &anySamplesPassed);
+				mLastOccludedCount += anySamplesPassed == GL_FALSE;
+				mLastResolvedCount++;
+			}
+		}
+		mIssued.clear();
+	}
+
+	bool OcclusionQueries::beginConditional(int object, const glm::vec3& boundsMin, const glm::vec3& boundsMax, Shader& drawShader)
+	{
+		//With the camera in or right next to the box its front faces get clipped away, and the object would vanish
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec3 p = glm::vec3(corner & 1 ? boundsMax.x : boundsMin.x, corner & 2 ? boundsMax.y : boundsMin.y, corner & 4 ? boundsMax.z : boundsMin.z);
+			glm::vec4 clip = mulMat4Vec4(mViewProjection, glm::vec4(p, 1.0f));
+			if (clip.z < -clip.w) {
+				return false;
+			}
+		}
+		if (object >= (int)mQueries.size()) {
+			size_t oldSize = mQueries.size();
+			mQueries.resize(object + 1);
+			glGenQueries((GLsizei)(mQueries.size() - oldSize), mQueries.data() + oldSize);
+		}
+
+		mBoxShader->use();
+		mBoxShader->setMat4("_Model", glm::scale(glm::translate(glm::mat4(1), (boundsMin + boundsMax) * 0.5f), boundsMax - boundsMin));
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthMask(GL_FALSE);
+		//In wireframe only the box's edges would be tested, missing an object seen through the box's faces
+		GLint polygonMode[2];
+		glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, mQueries[object]);
+		mBoxMesh->draw();
+		glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+		glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_TRUE);
+		mIssued.push_back(object);
+
+		drawShader.use();
+		glBeginConditionalRender(mQueries[object], GL_QUERY_NO_WAIT);
+		return true;
+	}
+
+	void OcclusionQueries::endConditional()
+	{
+		glEndConditionalRender();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "Mesh.h"
+#include "Shader.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// GPU occlusion tests for heavy objects. Before an object is drawn, its bounding box is drawn with color and depth
+	/// writes off inside a GL_ANY_SAMPLES_PASSED_CONSERVATIVE query, and the real draw is made conditional on that query
+	/// with GL_QUERY_NO_WAIT: the GPU skips it if no box sample passed, or draws anyway if the result isn't in yet.
+	/// The CPU never waits on a result. Draw likely occluders first so the depth buffer has something to test against.
+	/// Object ids are the caller's, one query object each, created on first use
+	/// </summary>
+	class OcclusionQueries {
+	public:
+		OcclusionQueries();
+		~OcclusionQueries();
+		//boxShader has to take _Model and already have the view projection set. Also collects last frame's results
+		//that are ready, for getLastOccludedCount
+		void beginFrame(Shader* boxShader, const glm::mat4& viewProjection);
+		//Below this many triangles the box costs about as much as the draw it could save
+		static inline bool isWorthQuerying(int numTriangles) { return numTriangles >= MIN_QUERY_TRIANGLES; }
+		//Draws the box in the object's query, starts conditional rendering and switches back to drawShader.
+		//Returns false, and draws no box, if the box crosses the near plane: the object has to be drawn anyway
+		bool beginConditional(int object, const glm::vec3& boundsMin, const glm::vec3& boundsMax, Shader& drawShader);
+		//Only after beginConditional returned true
+		void endConditional();
+
+		inline int getQueryCount()const { return (int)mIssued.size(); }
+		//Of last frame's queries whose results were ready by this frame, how many had no samples pass
+		inline int getLastOccludedCount()const { return mLastOccludedCount; }
+		inline int getLastResolvedCount()const { return mLastResolvedCount; }
+
+		static constexpr int MIN_QUERY_TRIANGLES = 1024;
+	private:
+		OcclusionQueries(const OcclusionQueries& r) = delete;
+		Mesh* mBoxMesh;
+		Shader* mBoxShader = nullptr;
+		glm::mat4 mViewProjection = glm::mat4(1);
+		std::vector<GLuint> mQueries;
+		//Objects queried this frame
+		std::vector<int> mIssued;
+		int mLastOccludedCount = 0;
+		int mLastResolvedCount = 0;
+	};
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace ew {
+	//Queried once, hardware_concurrency can be surprisingly slow on some platforms
+	inline int getWorkerCount() {
+		static const int workerCount = std::max(1, (int)std::thread::hardware_concurrency());
+		return workerCount;
+	}
+
+	/// <summary>
+	/// Splits [0, count) into one contiguous chunk per hardware thread and calls fn(begin, end) on each.
+	/// Chunks are never smaller than minPerThread, so small jobs just run on the calling thread.
+	/// </summary>
+	template<typename Func>
+	void parallelFor(int count, int minPerThread, Func fn) {
+		if (count <= 0) {
+			return;
+		}
+		int numChunks = std::min(getWorkerCount(), std::max(1, count / std::max(1, minPerThread)));
+		if (numChunks <= 1) {
+			fn(0, count);
+			return;
+		}
+		int chunkSize = (count + numChunks - 1) / numChunks;
+		std::vector<std::thread> threads;
+		threads.reserve(numChunks - 1);
+		for (int i = 1; i < numChunks; i++) {
+			int begin = i * chunkSize;
+			int end = std::min(count, begin + chunkSize);
+			if (begin < end) {
+				threads.emplace_back(fn, begin, end);
+			}
+		}
+		//Calling thread takes the first chunk instead of idling
+		fn(0, std::min(count, chunkSize));
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+}
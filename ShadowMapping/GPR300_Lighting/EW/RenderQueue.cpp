@@ -0,0 +1,150 @@
+#include "RenderQueue.h"
+#include "Parallel.h"
+#include <assert.h>
+
+namespace ew {
+	//Below this many packets per thread the sort stays on the calling thread
+	const int MIN_SORT_PER_THREAD = 16384;
+	const int RADIX_BITS = 8;
+	const int RADIX_BUCKETS = 1 << RADIX_BITS;
+
+	uint64_t RenderQueue::makeKey(int pass, int program, int material, int mesh, float depth)
+	{
+		assert(pass >> PASS_BITS == 0 && program >> PROGRAM_BITS == 0 && material >> MATERIAL_BITS == 0 && mesh >> MESH_BITS == 0);
+		uint64_t maxDepth = (1ull << DEPTH_BITS) - 1;
+		uint64_t quantizedDepth = (uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * maxDepth);
+		uint64_t key = (uint64_t)pass;
+		key = (key << PROGRAM_BITS) | (uint64_t)program;
+		key = (key << MATERIAL_BITS) | (uint64_t)material;
+		key = (key << MESH_BITS) | (uint64_t)mesh;
+		key = (key << DEPTH_BITS) | quantizedDepth;
+		return key;
+	}
+
+	int RenderQueue::getResourceId(const void* resource)
+	{
+		auto it = mResourceIds.find(resource);
+		if (it != mResourceIds.end()) {
+			return it->second;
+		}
+		int id = (int)mResourceIds.size();
+		mResourceIds[resource] = id;
+		return id;
+	}
+
+	void RenderQueue::clear()
+	{
+		mPackets.clear();
+		mEntries.clear();
+	}
+
+	void RenderQueue::submit(uint64_t key, const DrawPacket& packet)
+	{
+		mEntries.push_back({ key, (uint32_t)mPackets.size() });
+		mPackets.push_back(packet);
+	}
+
+	glm::ivec3 RenderQueue::countSwitches(const std::vector<SortEntry>& order)const
+	{
+		glm::ivec3 switches = glm::ivec3(0);
+		const DrawPacket* previous = nullptr;
+		GLuint texture = 0;
+		for (const SortEntry& entry : order) {
+			const DrawPacket& packet = mPackets[entry.packet];
+			switches.x += !previous || packet.shader != previous->shader;
+			switches.y += !previous || packet.mesh != previous->mesh;
+			if (packet.texture != 0 && packet.texture != texture) {
+				texture = packet.texture;
+				switches.z++;
+			}
+			previous = &packet;
+		}
+		return switches;
+	}
+
+	void RenderQueue::sort(bool parallel)
+	{
+		mSubmittedSwitches = countSwitches(mEntries);
+		radixSort(parallel);
+	}
+
+	void RenderQueue::radixSort(bool parallel)
+	{
+		const int NUM_DIGITS = 64 / RADIX_BITS;
+		int count = (int)mEntries.size();
+		mScratch.resize(count);
+		int numChunks = parallel ? std::max(1, std::min(getWorkerCount(), count / MIN_SORT_PER_THREAD)) : 1;
+		int chunkSize = (count + numChunks - 1) / numChunks;
+
+		//Every digit's histogram from one read of the keys, to find the digits worth a pass
+		std::vector<int> digitHistograms(numChunks * NUM_DIGITS * RADIX_BUCKETS, 0);
+		parallelFor(numChunks, 1, [&](int chunkBegin, int chunkEnd) {
+			for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+				int* histograms = &digitHistograms[chunk * NUM_DIGITS * RADIX_BUCKETS];
+				int end = std::min(count, (chunk + 1) * chunkSize);
+				for (int i = chunk * chunkSize; i < end; i++) {
+					uint64_t key = mEntries[i].key;
+					for (int digit = 0; digit < NUM_DIGITS; digit++) {
+						histograms[digit * RADIX_BUCKETS + ((key >> (digit * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+					}
+				}
+			}
+		});
+		for (int chunk = 1; chunk < numChunks; chunk++) {
+			for (int i = 0; i < NUM_DIGITS * RADIX_BUCKETS; i++) {
+				digitHistograms[i] += digitHistograms[chunk * NUM_DIGITS * RADIX_BUCKETS + i];
+			}
+		}
+
+		//Per chunk counts for the current pass, turned into that chunk's scatter offsets
+		std::vector<int> offsets(numChunks * RADIX_BUCKETS);
+		SortEntry* source = mEntries.data();
+		SortEntry* destination = mScratch.data();
+		for (int digit = 0; digit < NUM_DIGITS; digit++) {
+			const int* histogram = &digitHistograms[digit * RADIX_BUCKETS];
+			int shift = digit * RADIX_BITS;
+			//A digit every key shares doesn't reorder anything. Common here: pass and program only take a few values
+			if (std::find(histogram, histogram + RADIX_BUCKETS, count) != histogram + RADIX_BUCKETS) {
+				continue;
+			}
+			//Earlier passes moved keys between chunks, so chunks are counted again. One chunk is the whole histogram
+			if (numChunks == 1) {
+				std::copy(histogram, histogram + RADIX_BUCKETS, offsets.begin());
+			}
+			else {
+				std::fill(offsets.begin(), offsets.end(), 0);
+				parallelFor(numChunks, 1, [&](int chunkBegin, int chunkEnd) {
+					for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+						int* chunkCounts = &offsets[chunk * RADIX_BUCKETS];
+						int end = std::min(count, (chunk + 1) * chunkSize);
+						for (int i = chunk * chunkSize; i < end; i++) {
+							chunkCounts[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+						}
+					}
+				});
+			}
+			//Bucket major, chunk minor, so equal digits keep their order and the sort stays stable
+			int offset = 0;
+			for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+				for (int chunk = 0; chunk < numChunks; chunk++) {
+					int bucketCount = offsets[chunk * RADIX_BUCKETS + bucket];
+					offsets[chunk * RADIX_BUCKETS + bucket] = offset;
+					offset += bucketCount;
+				}
+			}
+			parallelFor(numChunks, 1, [&](int chunkBegin, int chunkEnd) {
+				for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+					int* chunkOffsets = &offsets[chunk * RADIX_BUCKETS];
+					int end = std::min(count, (chunk + 1) * chunkSize);
+					for (int i = chunk * chunkSize; i < end; i++) {
+						destination[chunkOffsets[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+					}
+				}
+			});
+			std::swap(source, destination);
+		}
+		if (source != mEntries.data()) {
+			mEntries.swap(mScratch);
+		}
+	}
+}
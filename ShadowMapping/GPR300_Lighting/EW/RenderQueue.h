@@ -0,0 +1,94 @@
+#pragma once
+#include "Mesh.h"
+#include "Shader.h"
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace ew {
+	/// <summary>
+	/// One draw in a RenderQueue. object is the caller's, handed back when the packet is executed
+	/// </summary>
+	struct DrawPacket {
+		Shader* shader;
+		Mesh* mesh;
+		GLuint texture;	//Bound to the active texture unit, 0 for none
+		int object;
+	};
+
+	/// <summary>
+	/// Draws submitted in any order, executed sorted by a 64 bit key: pass, then program, material and mesh, then
+	/// front to back so early Z rejects as much as it can. Program, texture and VAO are only bound when they change
+	/// from the previous packet. Keys are sorted with a parallel LSD radix sort, skipping bytes every key shares
+	/// </summary>
+	class RenderQueue {
+	public:
+		//Bits per key field, from most to least significant
+		static constexpr int PASS_BITS = 4;
+		static constexpr int PROGRAM_BITS = 8;
+		static constexpr int MATERIAL_BITS = 12;
+		static constexpr int MESH_BITS = 12;
+		static constexpr int DEPTH_BITS = 24;
+
+		//Ids have to fit their field. depth is 0 at the camera to 1 at the far plane, clamped
+		static uint64_t makeKey(int pass, int program, int material, int mesh, float depth);
+		//Small stable id for a program, mesh or texture, handed out in order of first use
+		int getResourceId(const void* resource);
+
+		void clear();
+		void submit(uint64_t key, const DrawPacket& packet);
+		void sort(bool parallel = true);
+		//For each packet in key order, binds what changed, calls setupDraw(packet) for per draw uniforms and draws
+		template<typename SetupDraw>
+		void execute(SetupDraw setupDraw);
+
+		inline int getPacketCount()const { return (int)mPackets.size(); }
+		//State changes executing would make in submission order, and made by the last execute. Counts the first bind
+		inline const glm::ivec3& getSubmittedSwitches()const { return mSubmittedSwitches; }
+		inline const glm::ivec3& getExecutedSwitches()const { return mExecutedSwitches; }
+	private:
+		struct SortEntry {
+			uint64_t key;
+			uint32_t packet;
+		};
+		//Program, VAO and texture changes along packets in order
+		glm::ivec3 countSwitches(const std::vector<SortEntry>& order)const;
+		void radixSort(bool parallel);
+
+		std::vector<DrawPacket> mPackets;
+		std::vector<SortEntry> mEntries;
+		std::vector<SortEntry> mScratch;
+		std::unordered_map<const void*, int> mResourceIds;
+		glm::ivec3 mSubmittedSwitches = glm::ivec3(0);
+		glm::ivec3 mExecutedSwitches = glm::ivec3(0);
+	};
+
+	template<typename SetupDraw>
+	void RenderQueue::execute(SetupDraw setupDraw)
+	{
+		Shader* shader = nullptr;
+		Mesh* mesh = nullptr;
+		GLuint texture = 0;
+		mExecutedSwitches = glm::ivec3(0);
+		for (const SortEntry& entry : mEntries) {
+			const DrawPacket& packet = mPackets[entry.packet];
+			if (packet.shader != shader) {
+				shader = packet.shader;
+				shader->use();
+				mExecutedSwitches.x++;
+			}
+			if (packet.mesh != mesh) {
+				mesh = packet.mesh;
+				mesh->bind();
+				mExecutedSwitches.y++;
+			}
+			if (packet.texture != 0 && packet.texture != texture) {
+				texture = packet.texture;
+				glBindTexture(GL_TEXTURE_2D, texture);
+				mExecutedSwitches.z++;
+			}
+			setupDraw(packet);
+			mesh->drawBound();
+		}
+	}
+}
@@ -0,0 +1,179 @@
+#include "SceneGraph.h"
+#include "SimdMath.h"
+#include <algorithm>
+#include <string.h>
+
+namespace ew {
+	static glm::mat4 composeLocal(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+	{
+		glm::mat3 r = glm::mat3_cast(rotation);
+		return glm::mat4(
+			glm::vec4(r[0] * scale.x, 0.0f),
+			glm::vec4(r[1] * scale.y, 0.0f),
+			glm::vec4(r[2] * scale.z, 0.0f),
+			glm::vec4(position, 1.0f));
+	}
+
+	int SceneGraph::createNode(int parent)
+	{
+		int handle = (int)mHandleToIndex.size();
+		//Appending keeps the order valid, the parent already exists so it comes first
+		int index = (int)mParents.size();
+		mHandleToIndex.push_back(index);
+		mIndexToHandle.push_back(handle);
+		mParents.push_back(parent == NO_PARENT ? NO_PARENT : mHandleToIndex[parent]);
+		mPositions.push_back(glm::vec3(0));
+		mRotations.push_back(glm::quat(1, 0, 0, 0));
+		mScales.push_back(glm::vec3(1));
+		mDirty.push_back(0);
+		mWorldMatrices.push_back(glm::mat4(1));
+		markDirty(index);
+		return handle;
+	}
+
+	bool SceneGraph::setParent(int node, int parent)
+	{
+		int index = mHandleToIndex[node];
+		int parentIndex = parent == NO_PARENT ? NO_PARENT : mHandleToIndex[parent];
+		for (int ancestor = parentIndex; ancestor != NO_PARENT; ancestor = mParents[ancestor]) {
+			if (ancestor == index) {
+				return false;
+			}
+		}
+		mParents[index] = parentIndex;
+		if (parentIndex > index) {
+			mNeedsSort = true;
+		}
+		markDirty(index);
+		return true;
+	}
+
+	int SceneGraph::getParent(int node)const
+	{
+		int parentIndex = mParents[mHandleToIndex[node]];
+		return parentIndex == NO_PARENT ? NO_PARENT : mIndexToHandle[parentIndex];
+	}
+
+	void SceneGraph::setLocalPosition(int node, const glm::vec3& position)
+	{
+		int index = mHandleToIndex[node];
+		mPositions[index] = position;
+		markDirty(index);
+	}
+
+	void SceneGraph::setLocalRotation(int node, const glm::quat& rotation)
+	{
+		int index = mHandleToIndex[node];
+		mRotations[index] = rotation;
+		markDirty(index);
+	}
+
+	void SceneGraph::setLocalScale(int node, const glm::vec3& scale)
+	{
+		int index = mHandleToIndex[node];
+		mScales[index] = scale;
+		markDirty(index);
+	}
+
+	void SceneGraph::markDirty(int index)
+	{
+		mDirty[index] = 1;
+		mFirstDirty = std::min(mFirstDirty, index);
+	}
+
+	void SceneGraph::sortNodes()
+	{
+		int count = (int)mParents.size();
+		//Children lists as offsets into one array
+		std::vector<int> childStart(count + 1, 0);
+		for (int i = 0; i < count; i++) {
+			if (mParents[i] != NO_PARENT) {
+				childStart[mParents[i] + 1]++;
+			}
+		}
+		for (int i = 0; i < count; i++) {
+			childStart[i + 1] += childStart[i];
+		}
+		std::vector<int> children(childStart[count]);
+		std::vector<int> fill(childStart.begin(), childStart.end() - 1);
+		for (int i = 0; i < count; i++) {
+			if (mParents[i] != NO_PARENT) {
+				children[fill[mParents[i]]++] = i;
+			}
+		}
+
+		//Depth first from each root, so subtrees also end up contiguous
+		std::vector<int> order;
+		order.reserve(count);
+		std::vector<int> stack;
+		for (int root = 0; root < count; root++)
+		{
+			if (mParents[root] != NO_PARENT) {
+				continue;
+			}
+			stack.push_back(root);
+			while (!stack.empty())
+			{
+				int index = stack.back();
+				stack.pop_back();
+				order.push_back(index);
+				for (int c = childStart[index + 1] - 1; c >= childStart[index]; c--) {
+					stack.push_back(children[c]);
+				}
+			}
+		}
+
+		std::vector<int> newIndex(count);
+		for (int i = 0; i < count; i++) {
+			newIndex[order[i]] = i;
+		}
+		std::vector<int> parents(count), indexToHandle(count);
+		std::vector<glm::vec3> positions(count), scales(count);
+		std::vector<glm::quat> rotations(count);
+		for (int i = 0; i < count; i++)
+		{
+			int old = order[i];
+			parents[i] = mParents[old] == NO_PARENT ? NO_PARENT : newIndex[mParents[old]];
+			indexToHandle[i] = mIndexToHandle[old];
+			positions[i] = mPositions[old];
+			rotations[i] = mRotations[old];
+			scales[i] = mScales[old];
+			mHandleToIndex[mIndexToHandle[old]] = i;
+		}
+		mParents.swap(parents);
+		mIndexToHandle.swap(indexToHandle);
+		mPositions.swap(positions);
+		mRotations.swap(rotations);
+		mScales.swap(scales);
+
+		//World matrices moved too, simplest to rebuild everything once
+		std::fill(mDirty.begin(), mDirty.end(), 1);
+		mFirstDirty = 0;
+		mNeedsSort = false;
+	}
+
+	void SceneGraph::update()
+	{
+		if (mNeedsSort) {
+			sortNodes();
+		}
+		int count = (int)mParents.size();
+		mLastUpdatedCount = 0;
+		//Parents always come first, so by the time a node is reached its parent's flag says whether it moved this frame
+		for (int i = mFirstDirty; i < count; i++)
+		{
+			int parent = mParents[i];
+			if (!mDirty[i] && (parent == NO_PARENT || !mDirty[parent])) {
+				continue;
+			}
+			mDirty[i] = 1;
+			glm::mat4 local = composeLocal(mPositions[i], mRotations[i], mScales[i]);
+			mWorldMatrices[i] = parent == NO_PARENT ? local : mulMat4(mWorldMatrices[parent], local);
+			mLastUpdatedCount++;
+		}
+		if (mFirstDirty < count) {
+			memset(&mDirty[mFirstDirty], 0, count - mFirstDirty);
+		}
+		mFirstDirty = count;
+	}
+}
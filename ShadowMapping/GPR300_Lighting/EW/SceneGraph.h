@@ -0,0 +1,53 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace ew {
+	/// <summary>
+	/// Node hierarchy with quaternion local transforms. Nodes live in flat arrays sorted so every parent comes
+	/// before its children, which lets update() rebuild world matrices in one forward sweep that only touches
+	/// dirty nodes and their descendants. Nodes are referred to by handles, which stay valid when the arrays are re-sorted.
+	/// </summary>
+	class SceneGraph {
+	public:
+		static constexpr int NO_PARENT = -1;
+
+		int createNode(int parent = NO_PARENT);
+		//Fails and returns false if it would make a cycle
+		bool setParent(int node, int parent);
+		int getParent(int node)const;
+
+		void setLocalPosition(int node, const glm::vec3& position);
+		void setLocalRotation(int node, const glm::quat& rotation);
+		void setLocalScale(int node, const glm::vec3& scale);
+		inline const glm::vec3& getLocalPosition(int node)const { return mPositions[mHandleToIndex[node]]; }
+		inline const glm::quat& getLocalRotation(int node)const { return mRotations[mHandleToIndex[node]]; }
+		inline const glm::vec3& getLocalScale(int node)const { return mScales[mHandleToIndex[node]]; }
+
+		//Rebuilds world matrices of dirty nodes and everything under them
+		void update();
+		//Valid after update()
+		inline const glm::mat4& getWorldMatrix(int node)const { return mWorldMatrices[mHandleToIndex[node]]; }
+		inline int getNodeCount()const { return (int)mParents.size(); }
+		inline int getLastUpdatedCount()const { return mLastUpdatedCount; }
+	private:
+		void markDirty(int index);
+		//Re-sorts depth first, so parents precede children again after a reparent broke the order
+		void sortNodes();
+
+		std::vector<int> mHandleToIndex;
+		std::vector<int> mIndexToHandle;
+		//Indexed by sorted position. Parents are sorted indices too
+		std::vector<int> mParents;
+		std::vector<glm::vec3> mPositions;
+		std::vector<glm::quat> mRotations;
+		std::vector<glm::vec3> mScales;
+		std::vector<uint8_t> mDirty;
+		std::vector<glm::mat4> mWorldMatrices;
+		int mFirstDirty = 0;
+		bool mNeedsSort = false;
+		int mLastUpdatedCount = 0;
+	};
+}
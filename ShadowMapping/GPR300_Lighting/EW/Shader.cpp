@@ -18,12 +18,44 @@ Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath)
 	std::string fragmentShaderString = readFile(fragmentShaderPath);
 	GLuint fragmentShader = compileShader(fragmentShaderString.c_str(), GL_FRAGMENT_SHADER);
 
+	GLuint shaders[] = { vertexShader, fragmentShader };
+	linkProgram(shaders, 2);
+}
+
+Shader::Shader(std::string vertexShaderPath, std::string tessControlShaderPath, std::string tessEvaluationShaderPath, std::string fragmentShaderPath)
+{
+	std::string vertexShaderString = readFile(vertexShaderPath);
+	GLuint vertexShader = compileShader(vertexShaderString.c_str(), GL_VERTEX_SHADER);
+
+	std::string tessControlShaderString = readFile(tessControlShaderPath);
+	GLuint tessControlShader = compileShader(tessControlShaderString.c_str(), GL_TESS_CONTROL_SHADER);
+
+	std::string tessEvaluationShaderString = readFile(tessEvaluationShaderPath);
+	GLuint tessEvaluationShader = compileShader(tessEvaluationShaderString.c_str(), GL_TESS_EVALUATION_SHADER);
+
+	std::string fragmentShaderString = readFile(fragmentShaderPath);
+	GLuint fragmentShader = compileShader(fragmentShaderString.c_str(), GL_FRAGMENT_SHADER);
+
+	GLuint shaders[] = { vertexShader, tessControlShader, tessEvaluationShader, fragmentShader };
+	linkProgram(shaders, 4);
+}
+
+Shader::Shader(std::string computeShaderPath)
+{
+	std::string computeShaderString = readFile(computeShaderPath);
+	GLuint computeShader = compileShader(computeShaderString.c_str(), GL_COMPUTE_SHADER);
+	linkProgram(&computeShader, 1);
+}
+
+void Shader::linkProgram(const GLuint* shaders, int numShaders)
+{
 	//Create an empty shader program
 	m_id = glCreateProgram();
 
 	//Attach our shader objects
-	glAttachShader(m_id, vertexShader);
-	glAttachShader(m_id, fragmentShader);
+	for (int i = 0; i < numShaders; i++) {
+		glAttachShader(m_id, shaders[i]);
+	}
 
 	//Link program - will create an executable program with the attached shaders
 	glLinkProgram(m_id);
@@ -38,8 +70,9 @@ Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath)
 		printf("Failed to link shader program: %s", infoLog);
 	}
 
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	for (int i = 0; i < numShaders; i++) {
+		glDeleteShader(shaders[i]);
+	}
 }
 
 void Shader::use()
@@ -57,6 +90,11 @@ void Shader::setInt(std::string name, int value)
 	glProgramUniform1i(m_id, glGetUniformLocation(m_id, name.c_str()), value);
 }
 
+void Shader::setMat3(std::string name, const glm::mat3& value)
+{
+	glProgramUniformMatrix3fv(m_id, glGetUniformLocation(m_id, name.c_str()), 1, false, glm::value_ptr(value));
+}
+
 void Shader::setMat4(std::string name, const glm::mat4& value) { 
 	glProgramUniformMatrix4fv(m_id, glGetUniformLocation(m_id, name.c_str()), 1, false, glm::value_ptr(value));
 }
@@ -66,11 +104,31 @@ void Shader::setVec3(std::string name, const glm::vec3& value)
 	glProgramUniform3f(m_id, glGetUniformLocation(m_id, name.c_str()), value.x, value.y, value.z);
 }
 
+void Shader::setVec4(std::string name, const glm::vec4& value)
+{
+	glProgramUniform4f(m_id, glGetUniformLocation(m_id, name.c_str()), value.x, value.y, value.z, value.w);
+}
+
 void Shader::setVec2(std::string name, const glm::vec2& value)
 {
 	glProgramUniform2f(m_id, glGetUniformLocation(m_id, name.c_str()), value.x, value.y);
 }
 
+GLint Shader::getUniformLocation(const std::string& name)const
+{
+	return glGetUniformLocation(m_id, name.c_str());
+}
+
+void Shader::setInt(GLint location, int value)
+{
+	glProgramUniform1i(m_id, location, value);
+}
+
+void Shader::setIntArray(GLint location, const int* values, int count)
+{
+	glProgramUniform1iv(m_id, location, count, values);
+}
+
 
 std::string Shader::readFile(const std::string& filePath)
 {
@@ -79,8 +137,20 @@ std::string Shader::readFile(const std::string& filePath)
 	if (!fileStream.is_open()) {
 		printf("Failed to open file %s ", filePath.c_str());
 	}
+	//Expand #include "file" lines, paths are relative to the including file
+	std::string directory = filePath.substr(0, filePath.find_last_of("/\\") + 1);
 	std::stringstream stringStream;
-	stringStream << fileStream.rdbuf();
+	std::string line;
+	while (std::getline(fileStream, line)) {
+		size_t open = line.find("#include \"");
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 10);
+		if (close != std::string::npos) {
+			stringStream << readFile(directory + line.substr(open + 10, close - open - 10)) << "\n";
+		}
+		else {
+			stringStream << line << "\n";
+		}
+	}
 	fileStream.close();
 	return stringStream.str();
 }
@@ -97,7 +167,13 @@ GLuint Shader::compileShader(const char* shaderSource, GLenum shaderType)
 	GLint success;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 	if (!success) {
-		const char* shaderName = shaderType == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT";
+		const char* shaderName = "FRAGMENT";
+		switch (shaderType) {
+		case GL_VERTEX_SHADER: shaderName = "VERTEX"; break;
+		case GL_TESS_CONTROL_SHADER: shaderName = "TESS CONTROL"; break;
+		case GL_TESS_EVALUATION_SHADER: shaderName = "TESS EVALUATION"; break;
+		case GL_COMPUTE_SHADER: shaderName = "COMPUTE"; break;
+		}
 		//Dump logs into a char array - 512 is an arbitrary length
 		GLchar infoLog[512];
 		glGetShaderInfoLog(shader, 512, NULL, infoLog);
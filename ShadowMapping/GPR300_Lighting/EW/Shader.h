@@ -9,16 +9,27 @@ class Shader
 {
 public:
 	Shader(std::string vertexShaderPath, std::string fragmentShaderPath);
+	//Program with tessellation stages. Draw it with GL_PATCHES
+	Shader(std::string vertexShaderPath, std::string tessControlShaderPath, std::string tessEvaluationShaderPath, std::string fragmentShaderPath);
+	//Compute program. use() it, then glDispatchCompute
+	Shader(std::string computeShaderPath);
 	void use();
 	void setFloat(std::string name, float value);
 	void setInt(std::string name, int value);
+	void setMat3(std::string name, const glm::mat3& value);
 	void setMat4(std::string name, const glm::mat4& value);
 	void setVec2(std::string name, const glm::vec2& value);
 	void setVec3(std::string name, const glm::vec3& value);
+	void setVec4(std::string name, const glm::vec4& value);
+	//For uniforms set once per draw, look the location up once and set by location, no string per call
+	GLint getUniformLocation(const std::string& name)const;
+	void setInt(GLint location, int value);
+	void setIntArray(GLint location, const int* values, int count);
 private:
 	Shader(const Shader& r) = delete;
 	std::string readFile(const std::string& filePath);
 	GLuint compileShader(const char* shaderSource, GLenum type);
+	void linkProgram(const GLuint* shaders, int numShaders);
 	GLuint m_id;
 };
 
@@ -1,130 +1,73 @@
 //Author: Eric Winebrenner
 
 #include "ShapeGen.h"
+#include "Parallel.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <xmmintrin.h>
+#include <unordered_map>
+#include <stdint.h>
 
 namespace ew {
+	template<size_t NumVertices, size_t NumIndices>
+	static void copyStaticMeshData(const StaticMeshData<NumVertices, NumIndices>& staticMeshData, MeshData& meshData)
+	{
+		meshData.vertices.assign(staticMeshData.vertices.begin(), staticMeshData.vertices.end());
+		meshData.indices.assign(staticMeshData.indices.begin(), staticMeshData.indices.end());
+	}
+
 	void createPlane(float width, float height, MeshData& meshData) {
-		meshData.vertices.clear();
-		meshData.indices.clear();
-		float halfWidth = width / 2.0f;
-		float halfHeight = height / 2.0f;
-		Vertex vertices[4] = {
-			//Front face
-			{glm::vec3(-halfWidth, 0, -halfHeight), glm::vec3(0,1,0), glm::vec2(0, 0)}, //BL
-			{glm::vec3(+halfWidth, 0, -halfHeight), glm::vec3(0,1,0), glm::vec2(1, 0)}, //BR
-			{glm::vec3(+halfWidth, 0, +halfHeight), glm::vec3(0,1,0), glm::vec2(1, 1)}, //TR
-			{glm::vec3(-halfWidth, 0, +halfHeight), glm::vec3(0,1,0), glm::vec2(0, 1)} //TL
-		};
-		meshData.vertices.assign(&vertices[0], &vertices[4]);
-		unsigned int indices[6] = {
-			// front face
-			0, 2, 1,
-			0, 3, 2
-		};
-		meshData.indices.assign(&indices[0], &indices[6]);
-	};
+		copyStaticMeshData(makePlane(width, height), meshData);
+	}
 
 	void createQuad(float width, float height, MeshData& meshData) {
-		meshData.vertices.clear();
-		meshData.indices.clear();
-		float halfWidth = width / 2.0f;
-		float halfHeight = height / 2.0f;
-		Vertex vertices[4] = {
-			//Front face
-			{glm::vec3(-halfWidth, -halfHeight, 0), glm::vec3(0,0,1), glm::vec2(0, 0)}, //BL
-			{glm::vec3(+halfWidth, -halfHeight, 0), glm::vec3(0,0,1), glm::vec2(1, 0)}, //BR
-			{glm::vec3(+halfWidth, +halfHeight, 0), glm::vec3(0,0,1), glm::vec2(1, 1)}, //TR
-			{glm::vec3(-halfWidth, +halfHeight, 0), glm::vec3(0,0,1), glm::vec2(0, 1)} //TL
-		};
-		meshData.vertices.assign(&vertices[0], &vertices[4]);
-		unsigned int indices[6] = {
-			// front face
-			0, 1, 2,
-			0, 2, 3
-		};
-		meshData.indices.assign(&indices[0], &indices[6]);
-	};
+		copyStaticMeshData(makeQuad(width, height), meshData);
+	}
 
 	void createCube(float width, float height, float depth, MeshData& meshData)
 	{
-		meshData.vertices.clear();
-		meshData.indices.clear();
-
-		float halfWidth = width / 2.0f;
-		float halfHeight = height / 2.0f;
-		float halfDepth = depth / 2.0f;
-
-		//VERTICES
-		//-------------
-		Vertex vertices[24] = {
-			//Front face
-			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(0, 0)}, //BL
-			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(1, 0)}, //BR
-			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(1, 1)}, //TR
-			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(0, 1)}, //TL
-
-			//Back face
-			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(0, 0)}, //BL
-			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(1, 0)}, //BR
-			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(1, 1)}, //TR
-			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(0, 1)}, //TL
-
-			//Right face
-			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(1,0,0), glm::vec2(0, 0)}, //BL
-			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(1,0,0), glm::vec2(1, 0)}, //BR
-			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(1,0,0), glm::vec2(1, 1)}, //TR
-			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(1,0,0), glm::vec2(0, 1)}, //TL
-
-			//Left face
-			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(-1,0,0), glm::vec2(0, 0)}, //BL
-			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(-1,0,0), glm::vec2(1, 0)}, //BR
-			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(-1,0,0), glm::vec2(1, 1)}, //TR
-			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(-1,0,0), glm::vec2(0, 1)}, //TL
-
-			//Top face
-			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(0,1,0), glm::vec2(0, 0)}, //BL
-			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(0,1,0), glm::vec2(1, 0)}, //BR
-			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(0,1,0), glm::vec2(1, 1)}, //TR
-			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(0,1,0), glm::vec2(0, 1)}, //TL
-
-			//Bottom face
-			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(0,-1,0), glm::vec2(0, 0)}, //BL
-			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(0,-1,0), glm::vec2(1, 0)}, //BR
-			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(0,-1,0), glm::vec2(1, 1)}, //TR
-			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(0,-1,0), glm::vec2(0, 1)}, //TL
-		};
-		meshData.vertices.assign(&vertices[0], &vertices[24]);
-
-		//INDICES
-		//-------------
-
-		unsigned int indices[36] = {
-			// front face
-			0, 1, 2,
-			0, 2, 3,
-
-			// back face
-			4, 5, 6,
-			6, 7, 4,
-
-			// right face
-			8,  9, 10,
-			10, 11, 8,
-
-			//left face 
-			12, 13, 14,
-			14, 15, 12,
-
-			//top face
-			16,17,18,
-			18,19,16,
+		copyStaticMeshData(makeCube(width, height, depth), meshData);
+	}
 
-			//bottom face
-			20, 21, 22,
-			22, 23, 20
-		};
-		meshData.indices.assign(&indices[0], &indices[36]);
+	//Writes one ring of sphere vertices. Positions and normals are computed 4 columns at a time,
+	//in the same operation order as the scalar glm code, so results are bit identical to it.
+	static void emitSphereRow(Vertex* row, int numColumns, float radius, float phi,
+		float sinPhi, float cosPhi, const float* sinTheta, const float* cosTheta, const float* u)
+	{
+		float ringRadius = radius * sinPhi;
+		float y = radius * cosPhi;
+		__m128 ringRadius4 = _mm_set1_ps(ringRadius);
+		__m128 y4 = _mm_set1_ps(y);
+		__m128 yy4 = _mm_mul_ps(y4, y4);
+		__m128 one4 = _mm_set1_ps(1.0f);
+
+		int j = 0;
+		for (; j + 4 <= numColumns; j += 4)
+		{
+			__m128 x4 = _mm_mul_ps(ringRadius4, _mm_loadu_ps(sinTheta + j));
+			__m128 z4 = _mm_mul_ps(ringRadius4, _mm_loadu_ps(cosTheta + j));
+			__m128 lengthSq4 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x4, x4), yy4), _mm_mul_ps(z4, z4));
+			__m128 invLength4 = _mm_div_ps(one4, _mm_sqrt_ps(lengthSq4));
+
+			alignas(16) float x[4], z[4], nx[4], ny[4], nz[4];
+			_mm_store_ps(x, x4);
+			_mm_store_ps(z, z4);
+			_mm_store_ps(nx, _mm_mul_ps(x4, invLength4));
+			_mm_store_ps(ny, _mm_mul_ps(y4, invLength4));
+			_mm_store_ps(nz, _mm_mul_ps(z4, invLength4));
+			for (int k = 0; k < 4; k++) {
+				Vertex& v = row[j + k];
+				v.position = glm::vec3(x[k], y, z[k]);
+				v.normal = glm::vec3(nx[k], ny[k], nz[k]);
+				v.UV = glm::vec2(u[j + k], phi);
+				v.tangent = glm::vec4(cosTheta[j + k], 0, -sinTheta[j + k], -1.0f);
+			}
+		}
+		//Leftover columns
+		for (; j < numColumns; j++)
+		{
+			glm::vec3 position = glm::vec3(ringRadius * sinTheta[j], y, ringRadius * cosTheta[j]);
+			row[j] = Vertex(position, glm::normalize(position), glm::vec2(u[j], phi), glm::vec3(cosTheta[j], 0, -sinTheta[j]), -1.0f);
+		}
 	}
 
 	void createSphere(float radius, int numSegments, MeshData& meshData)
@@ -135,73 +78,83 @@ namespace ew {
 		float topY = radius;
 		float bottomY = -radius;
 
-		unsigned int topIndex = 0;
-		meshData.vertices.push_back({ glm::vec3(0,topY,0),glm::vec3(0,1,0), glm::vec2(0)});
-
 		//Angle between segments
 		float thetaStep = (2.0f * glm::pi<float>()) / (float)numSegments;
 		float phiStep = (glm::pi<float>()) / (float)numSegments;
 
-		for (int i = 1; i < numSegments; i++)
+		//Every ring shares the same sin/cos(theta) per column, so only compute them once
+		unsigned int ringVertexCount = numSegments + 1;
+		std::vector<float> sinTheta(ringVertexCount), cosTheta(ringVertexCount), u(ringVertexCount);
+		for (unsigned int j = 0; j < ringVertexCount; j++)
 		{
-			float phi = phiStep * i;
+			float theta = thetaStep * j;
+			sinTheta[j] = sinf(theta);
+			cosTheta[j] = cosf(theta);
+			u[j] = theta / glm::pi<float>();
+		}
 
-			//Create row
-			for (int j = 0; j <= numSegments; ++j)
+		int numRows = glm::max(numSegments - 1, 0);
+		unsigned int topIndex = 0;
+		unsigned int bottomIndex = numRows * ringVertexCount + 1;
+		meshData.vertices.resize(bottomIndex + 1);
+		meshData.vertices[topIndex] = Vertex(glm::vec3(0, topY, 0), glm::vec3(0, 1, 0), glm::vec2(0), glm::vec3(1, 0, 0), -1.0f);
+		meshData.vertices[bottomIndex] = Vertex(glm::vec3(0, bottomY, 0), glm::vec3(0, -1, 0), glm::vec2(1), glm::vec3(1, 0, 0), -1.0f);
+
+		Vertex* rows = &meshData.vertices[1];
+		parallelFor(numRows, 64, [&](int begin, int end) {
+			for (int r = begin; r < end; r++)
 			{
-				float theta = thetaStep * j;
-
-				float x = radius * sinf(phi) * sinf(theta);
-				float y = radius * cosf(phi);
-				float z = radius * sinf(phi) * cosf(theta);
-
-				glm::vec3 position = glm::vec3(x, y, z);
-				glm::vec3 normal = glm::normalize(glm::vec3(x, y, z));
-
-				meshData.vertices.push_back({position, normal, glm::vec2(theta / glm::pi<float>(), phi)});
+				float phi = phiStep * (r + 1);
+				emitSphereRow(rows + r * ringVertexCount, ringVertexCount, radius, phi,
+					sinf(phi), cosf(phi), sinTheta.data(), cosTheta.data(), u.data());
 			}
-		}
+		});
 
-		meshData.vertices.push_back({ glm::vec3(0,bottomY,0), glm::vec3(0,-1,0), glm::vec2(1) });
-		unsigned int bottomIndex = (unsigned int)meshData.vertices.size() - 1;
-		unsigned int ringVertexCount = numSegments + 1;
+		int numRingQuadRows = glm::max(numSegments - 2, 0);
+		size_t topCapIndexCount = (size_t)numSegments * 3;
+		size_t ringsIndexCount = (size_t)numRingQuadRows * numSegments * 6;
+		meshData.indices.resize(topCapIndexCount + ringsIndexCount + ringVertexCount * 3);
+		unsigned int* indices = meshData.indices.data();
 
 		//TOP CAP
 		for (int i = 0; i < numSegments; ++i) {
-			meshData.indices.push_back(topIndex); //top cap center 
-			meshData.indices.push_back(i + 1);
-			meshData.indices.push_back(i + 2);
+			indices[i * 3 + 0] = topIndex; //top cap center 
+			indices[i * 3 + 1] = i + 1;
+			indices[i * 3 + 2] = i + 2;
 		}
 
 		//RINGS
 		unsigned int start = 1;
-
-		//Row index
-		//-2 to ignore poles
-		for (int y = 0; y < numSegments - 2; ++y)
-		{
-			//Column index
-			for (int x = 0; x < numSegments; ++x)
+		unsigned int* ringIndices = indices + topCapIndexCount;
+		parallelFor(numRingQuadRows, 64, [&](int begin, int end) {
+			//Row index
+			for (int y = begin; y < end; ++y)
 			{
-				//Triangle 1
-				meshData.indices.push_back(start + y * ringVertexCount + x);
-				meshData.indices.push_back(start + (y + 1) * ringVertexCount + x);
-				meshData.indices.push_back(start + y * ringVertexCount + x + 1);
-
-				//Triangle 2
-				meshData.indices.push_back(start + y * ringVertexCount + x + 1);
-				meshData.indices.push_back(start + (y + 1) * ringVertexCount + x);
-				meshData.indices.push_back(start + (y + 1) * ringVertexCount + x + 1);
+				unsigned int* out = ringIndices + (size_t)y * numSegments * 6;
+				//Column index
+				for (int x = 0; x < numSegments; ++x)
+				{
+					//Triangle 1
+					*out++ = start + y * ringVertexCount + x;
+					*out++ = start + (y + 1) * ringVertexCount + x;
+					*out++ = start + y * ringVertexCount + x + 1;
+
+					//Triangle 2
+					*out++ = start + y * ringVertexCount + x + 1;
+					*out++ = start + (y + 1) * ringVertexCount + x;
+					*out++ = start + (y + 1) * ringVertexCount + x + 1;
+				}
 			}
-		}
+		});
 
 		start = bottomIndex - ringVertexCount;
 
 		//BOTTOM CAP
+		unsigned int* bottomIndices = ringIndices + ringsIndexCount;
 		for (unsigned int i = 0; i < ringVertexCount; ++i) {
-			meshData.indices.push_back(start + i + 1);
-			meshData.indices.push_back(start + i);
-			meshData.indices.push_back(bottomIndex); //bottom cap center 
+			bottomIndices[i * 3 + 0] = start + i + 1;
+			bottomIndices[i * 3 + 1] = start + i;
+			bottomIndices[i * 3 + 2] = bottomIndex; //bottom cap center 
 		}
 	}
 
@@ -213,78 +166,362 @@ namespace ew {
 		float halfHeight = height * 0.5f;
 		float thetaStep = glm::pi<float>() * 2.0f / numSegments;
 
-		//VERTICES
-		//Top cap (facing up)
-		meshData.vertices.push_back(Vertex(glm::vec3(0, halfHeight, 0), glm::vec3(0, 1, 0), glm::vec2(0)));
-		for (int i = 0; i <= numSegments; i++)
+		//All four rings share the same angles, so each cos/sin is only computed once
+		unsigned int ringVertexCount = numSegments + 1;
+		std::vector<float> ringX(ringVertexCount), ringZ(ringVertexCount);
+		for (unsigned int i = 0; i < ringVertexCount; i++)
 		{
-			glm::vec3 pos = glm::vec3(
-				cos(i * thetaStep) * radius,
-				halfHeight,
-				sin(i * thetaStep) * radius
-			);
-			
-			meshData.vertices.push_back(Vertex(pos, glm::vec3(0, 1, 0), glm::vec2(pos.x, pos.z)));
+			ringX[i] = cos(i * thetaStep) * radius;
+			ringZ[i] = sin(i * thetaStep) * radius;
 		}
 
+		//VERTICES
+		unsigned int topCenterIndex = 0;
+		unsigned int bottomCenterIndex = ringVertexCount + 1;
+		unsigned int sideStartIndex = bottomCenterIndex + ringVertexCount + 1;
+		meshData.vertices.resize(sideStartIndex + ringVertexCount * 2);
+		Vertex* vertices = meshData.vertices.data();
+
+		//Top cap (facing up)
+		vertices[topCenterIndex] = Vertex(glm::vec3(0, halfHeight, 0), glm::vec3(0, 1, 0), glm::vec2(0), glm::vec3(1, 0, 0), -1.0f);
 		//Bottom cap (facing down)
-		meshData.vertices.push_back(Vertex(glm::vec3(0, -halfHeight, 0), glm::vec3(0, -1, 0), glm::vec2(0)));
-		unsigned int bottomCenterIndex = (unsigned int)meshData.vertices.size() - 1;
-		for (int i = 0; i <= numSegments; i++)
+		vertices[bottomCenterIndex] = Vertex(glm::vec3(0, -halfHeight, 0), glm::vec3(0, -1, 0), glm::vec2(0), glm::vec3(1, 0, 0));
+
+		parallelFor(ringVertexCount, 4096, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				glm::vec3 topPos = glm::vec3(ringX[i], halfHeight, ringZ[i]);
+				glm::vec3 bottomPos = glm::vec3(ringX[i], -halfHeight, ringZ[i]);
+				//Cap UVs are planar in XZ, so U runs along +X
+				vertices[topCenterIndex + i + 1] = Vertex(topPos, glm::vec3(0, 1, 0), glm::vec2(topPos.x, topPos.z), glm::vec3(1, 0, 0), -1.0f);
+				vertices[bottomCenterIndex + i + 1] = Vertex(bottomPos, glm::vec3(0, -1, 0), glm::vec2(bottomPos.x, bottomPos.z), glm::vec3(1, 0, 0));
+
+				//Sides (facing out), U runs around the ring
+				float positionX = (float)i / (float)numSegments;
+				glm::vec3 tangent = glm::normalize(glm::vec3(-ringZ[i], 0, ringX[i]));
+				glm::vec3 normal = glm::normalize(topPos - vertices[topCenterIndex].position);
+				vertices[sideStartIndex + i] = Vertex(topPos, normal, glm::vec2(positionX, 1), tangent, -1.0f);
+				normal = glm::normalize(bottomPos - vertices[bottomCenterIndex].position);
+				vertices[sideStartIndex + ringVertexCount + i] = Vertex(bottomPos, normal, glm::vec2(positionX, 0), tangent, -1.0f);
+			}
+		});
+
+		//INDICES
+		meshData.indices.resize((size_t)numSegments * 12);
+		unsigned int* topIndices = meshData.indices.data();
+		unsigned int* bottomIndices = topIndices + numSegments * 3;
+		unsigned int* sideIndices = bottomIndices + numSegments * 3;
+		parallelFor(numSegments, 4096, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				//Top cap
+				topIndices[i * 3 + 0] = i + 1;
+				topIndices[i * 3 + 1] = topCenterIndex;
+				topIndices[i * 3 + 2] = i + 2;
+				//Bottom cap
+				bottomIndices[i * 3 + 0] = bottomCenterIndex;
+				bottomIndices[i * 3 + 1] = bottomCenterIndex + i + 1;
+				bottomIndices[i * 3 + 2] = bottomCenterIndex + i + 2;
+				//Side quads
+				unsigned int start = sideStartIndex + i;
+				unsigned int* quad = sideIndices + i * 6;
+				quad[0] = start;
+				quad[1] = start + 1;
+				quad[2] = start + numSegments + 1;
+				quad[3] = start + numSegments + 1;
+				quad[4] = start + 1;
+				quad[5] = start + numSegments + 2;
+			}
+		});
+	}
+
+	//Equirectangular UV for a point on the unit sphere. U is 0 to 1 around Y starting at +Z, V is 0 at the bottom pole
+	//and 1 at the top. createSphere's UVs are scaled differently, U 0 to 2 and V 0 to PI from the top
+	static glm::vec2 getSphereUV(const glm::vec3& n)
+	{
+		float u = atan2f(n.x, n.z) / (2.0f * glm::pi<float>());
+		if (u < 0.0f) {
+			u += 1.0f;
+		}
+		float v = 1.0f - acosf(glm::clamp(n.y, -1.0f, 1.0f)) / glm::pi<float>();
+		return glm::vec2(u, v);
+	}
+
+	//Direction of increasing U for a given U, valid at the poles too
+	static glm::vec3 getSphereTangent(float u)
+	{
+		float theta = u * 2.0f * glm::pi<float>();
+		return glm::vec3(cosf(theta), 0, -sinf(theta));
+	}
+
+	static bool isSpherePole(const glm::vec3& n)
+	{
+		return fabsf(n.x) < 1e-6f && fabsf(n.z) < 1e-6f;
+	}
+
+	//Returns the vertex halfway along edge (a, b), only creating it the first time the edge is seen
+	static unsigned int getMidpoint(unsigned int a, unsigned int b, std::vector<glm::vec3>& points, std::unordered_map<uint64_t, unsigned int>& cache)
+	{
+		uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+		auto it = cache.find(key);
+		if (it != cache.end()) {
+			return it->second;
+		}
+		unsigned int index = (unsigned int)points.size();
+		points.push_back(glm::normalize(points[a] + points[b]));
+		cache.emplace(key, index);
+		return index;
+	}
+
+	void createIcosphere(float radius, int subdivisions, MeshData& meshData)
+	{
+		meshData.vertices.clear();
+		meshData.indices.clear();
+
+		//Unit icosahedron
+		float t = (1.0f + sqrtf(5.0f)) * 0.5f;
+		std::vector<glm::vec3> points = {
+			{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+			{0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+			{t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}
+		};
+		for (glm::vec3& point : points) {
+			point = glm::normalize(point);
+		}
+		std::vector<unsigned int> indices = {
+			0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+			1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+			3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+			4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+		};
+
+		//Split every triangle into 4. Neighbouring triangles share edge midpoints through the cache
+		std::unordered_map<uint64_t, unsigned int> midpointCache;
+		std::vector<unsigned int> subdivided;
+		for (int s = 0; s < subdivisions; s++)
 		{
-			glm::vec3 pos = glm::vec3(
-				cos(i * thetaStep) * radius,
-				-halfHeight,
-				sin(i * thetaStep) * radius
-			);
-			meshData.vertices.push_back(Vertex(pos, glm::vec3(0, -1, 0), glm::vec2(pos.x, pos.z)));
+			size_t numEdges = indices.size() / 2;
+			points.reserve(points.size() + numEdges);
+			midpointCache.clear();
+			midpointCache.reserve(numEdges);
+			subdivided.clear();
+			subdivided.reserve(indices.size() * 4);
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+				unsigned int ab = getMidpoint(a, b, points, midpointCache);
+				unsigned int bc = getMidpoint(b, c, points, midpointCache);
+				unsigned int ca = getMidpoint(c, a, points, midpointCache);
+				unsigned int tris[12] = { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca };
+				subdivided.insert(subdivided.end(), tris, tris + 12);
+			}
+			indices.swap(subdivided);
+		}
+
+		meshData.vertices.reserve(points.size() + points.size() / 8);
+		for (const glm::vec3& point : points) {
+			glm::vec2 uv = getSphereUV(point);
+			meshData.vertices.push_back(Vertex(point * radius, point, uv, getSphereTangent(uv.x)));
 		}
 
-		//Sides (facing out)
-		unsigned int sideStartIndex = (unsigned int)meshData.vertices.size();
-		//Side top ring
-		for (int i = 0; i <= numSegments; i++)
+		//SEAM
+		//Triangles that straddle U = 0/1 would interpolate across the whole texture.
+		//Give their low U corners a copy of the vertex with U + 1 instead, shared between triangles.
+		//Poles have no meaningful U, so they are left out here and fixed afterwards
+		std::unordered_map<unsigned int, unsigned int> seamCopies;
+		for (size_t i = 0; i < indices.size(); i += 3)
 		{
-			glm::vec3 pos = meshData.vertices[i + 1].position;
-			glm::vec3 normal = glm::normalize((pos - meshData.vertices[0].position));
-			float positionX = (float)i / (float)numSegments;
-			meshData.vertices.push_back(Vertex(pos, normal, glm::vec2(positionX, 1)));
+			float minU = 1.0f, maxU = 0.0f;
+			for (int k = 0; k < 3; k++)
+			{
+				const Vertex& v = meshData.vertices[indices[i + k]];
+				if (!isSpherePole(v.normal)) {
+					minU = glm::min(minU, v.UV.x);
+					maxU = glm::max(maxU, v.UV.x);
+				}
+			}
+			if (maxU - minU < 0.5f) {
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int index = indices[i + k];
+				if (meshData.vertices[index].UV.x >= 0.5f || isSpherePole(meshData.vertices[index].normal)) {
+					continue;
+				}
+				auto it = seamCopies.find(index);
+				if (it == seamCopies.end()) {
+					Vertex copy = meshData.vertices[index];
+					copy.UV.x += 1.0f;
+					meshData.vertices.push_back(copy);
+					it = seamCopies.emplace(index, (unsigned int)meshData.vertices.size() - 1).first;
+				}
+				indices[i + k] = it->second;
+			}
 		}
-		//Side bottom ring
-		for (int i = 0; i <= numSegments; i++)
+
+		//POLES
+		//U is undefined at the poles, so each triangle touching one gets its own pole vertex
+		//with U halfway between its other two corners
+		for (size_t i = 0; i < indices.size(); i += 3)
 		{
-			glm::vec3 pos = meshData.vertices[bottomCenterIndex + i + 1].position;
-			glm::vec3 normal = glm::normalize((pos - meshData.vertices[bottomCenterIndex].position));
-			float positionX = (float)i / (float)numSegments; 
-			meshData.vertices.push_back(Vertex(pos, normal, glm::vec2(positionX, 0)));
+			for (int k = 0; k < 3; k++)
+			{
+				const Vertex& pole = meshData.vertices[indices[i + k]];
+				if (!isSpherePole(pole.normal)) {
+					continue;
+				}
+				float u = (meshData.vertices[indices[i + (k + 1) % 3]].UV.x + meshData.vertices[indices[i + (k + 2) % 3]].UV.x) * 0.5f;
+				Vertex copy = pole;
+				copy.UV.x = u;
+				copy.tangent = glm::vec4(getSphereTangent(u), 1.0f);
+				meshData.vertices.push_back(copy);
+				indices[i + k] = (unsigned int)meshData.vertices.size() - 1;
+			}
 		}
+		meshData.indices.swap(indices);
+	}
 
-		//INDICES
-		//Top cap
-		for (int i = 0; i < numSegments; i++)
+	//Maps a point on the [-1, 1] cube onto the unit sphere. Spreads vertices more evenly than just normalizing
+	static glm::vec3 spherifyCubePoint(const glm::vec3& p)
+	{
+		glm::vec3 p2 = p * p;
+		return glm::vec3(
+			p.x * sqrtf(1.0f - p2.y * 0.5f - p2.z * 0.5f + p2.y * p2.z / 3.0f),
+			p.y * sqrtf(1.0f - p2.z * 0.5f - p2.x * 0.5f + p2.z * p2.x / 3.0f),
+			p.z * sqrtf(1.0f - p2.x * 0.5f - p2.y * 0.5f + p2.x * p2.y / 3.0f)
+		);
+	}
+
+	void createCubeSphere(float radius, int resolution, MeshData& meshData)
+	{
+		meshData.vertices.clear();
+		meshData.indices.clear();
+
+		//Normal, right (U) and up (V) of each cube face. right x up = normal so triangles wind CCW
+		const glm::vec3 faces[6][3] = {
+			{ glm::vec3(1, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0) },
+			{ glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0) },
+			{ glm::vec3(0, 1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1) },
+			{ glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1) },
+			{ glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0) },
+			{ glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0) }
+		};
+
+		//Faces don't share vertices, so every face gets its own 0-1 UV square and the edges need no seam fixing
+		unsigned int rowVertexCount = resolution + 1;
+		unsigned int faceVertexCount = rowVertexCount * rowVertexCount;
+		size_t faceIndexCount = (size_t)resolution * resolution * 6;
+		meshData.vertices.resize(faceVertexCount * 6);
+		meshData.indices.resize(faceIndexCount * 6);
+		Vertex* vertices = meshData.vertices.data();
+		unsigned int* indices = meshData.indices.data();
+		float step = 2.0f / resolution;
+		float tangentDelta = step * 0.01f;
+
+		parallelFor(6 * rowVertexCount, 64, [&](int begin, int end) {
+			for (int row = begin; row < end; row++)
+			{
+				int face = row / rowVertexCount;
+				int y = row % rowVertexCount;
+				const glm::vec3& normal = faces[face][0];
+				const glm::vec3& right = faces[face][1];
+				const glm::vec3& up = faces[face][2];
+				Vertex* out = vertices + face * faceVertexCount + y * rowVertexCount;
+				for (int x = 0; x <= resolution; x++)
+				{
+					glm::vec3 cubePoint = normal + right * (x * step - 1.0f) + up * (y * step - 1.0f);
+					glm::vec3 n = spherifyCubePoint(cubePoint);
+					//U follows the face's right axis. Difference it through the mapping and make it perpendicular to the normal
+					glm::vec3 du = spherifyCubePoint(cubePoint + right * tangentDelta) - spherifyCubePoint(cubePoint - right * tangentDelta);
+					glm::vec3 tangent = glm::normalize(du - n * glm::dot(du, n));
+					glm::vec2 uv = glm::vec2((float)x / resolution, (float)y / resolution);
+					out[x] = Vertex(n * radius, n, uv, tangent);
+				}
+
+				if (y == resolution) {
+					continue;
+				}
+				unsigned int start = face * faceVertexCount + y * rowVertexCount;
+				unsigned int* quad = indices + face * faceIndexCount + (size_t)y * resolution * 6;
+				for (int x = 0; x < resolution; x++, quad += 6)
+				{
+					unsigned int bl = start + x;
+					unsigned int br = bl + 1;
+					unsigned int tl = bl + rowVertexCount;
+					unsigned int tr = tl + 1;
+					quad[0] = bl; quad[1] = br; quad[2] = tr;
+					quad[3] = bl; quad[4] = tr; quad[5] = tl;
+				}
+			}
+		});
+	}
+
+	void createSphereControlMesh(float radius, MeshData& meshData)
+	{
+		meshData.vertices.clear();
+		meshData.indices.clear();
+
+		//Octahedron. Ring starts at +Z so the UV seam runs along patch edges
+		glm::vec3 points[6] = {
+			glm::vec3(0, 1, 0),
+			glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0),
+			glm::vec3(0, -1, 0)
+		};
+		for (const glm::vec3& point : points) {
+			glm::vec2 uv = getSphereUV(point);
+			meshData.vertices.push_back(Vertex(point * radius, point, uv, getSphereTangent(uv.x)));
+		}
+		for (unsigned int i = 0; i < 4; i++)
 		{
-			meshData.indices.push_back(i + 1);
-			meshData.indices.push_back(0);
-			meshData.indices.push_back(i + 2);
+			unsigned int a = 1 + i;
+			unsigned int b = 1 + (i + 1) % 4;
+			unsigned int patches[6] = {
+				0, a, b,
+				5, b, a
+			};
+			meshData.indices.insert(meshData.indices.end(), patches, patches + 6);
 		}
-		//Bottom cap
+	}
+
+	void createCylinderControlMesh(float height, float radius, int numSegments, MeshData& meshData)
+	{
+		meshData.vertices.clear();
+		meshData.indices.clear();
+		float halfHeight = height / 2.0f;
+		float thetaStep = (2.0f * glm::pi<float>()) / (float)numSegments;
+
+		//Top center + ring, bottom center + ring, then the side's top and bottom rings. No seam copies
+		unsigned int topCenter = 0;
+		unsigned int bottomCenter = numSegments + 1;
+		unsigned int sideStart = bottomCenter + numSegments + 1;
+		meshData.vertices.resize(sideStart + numSegments * 2);
+		meshData.vertices[topCenter] = Vertex(glm::vec3(0, halfHeight, 0), glm::vec3(0, 1, 0), glm::vec2(0), glm::vec3(1, 0, 0), -1.0f);
+		meshData.vertices[bottomCenter] = Vertex(glm::vec3(0, -halfHeight, 0), glm::vec3(0, -1, 0), glm::vec2(0), glm::vec3(1, 0, 0));
 		for (int i = 0; i < numSegments; i++)
 		{
-			meshData.indices.push_back(bottomCenterIndex);
-			meshData.indices.push_back(bottomCenterIndex + i + 1);
-			meshData.indices.push_back(bottomCenterIndex + i + 2);
+			float x = cosf(i * thetaStep) * radius;
+			float z = sinf(i * thetaStep) * radius;
+			glm::vec3 normal = glm::vec3(x, 0, z) / radius;
+			glm::vec3 tangent = glm::vec3(-normal.z, 0, normal.x);
+			glm::vec2 sideUV = glm::vec2((float)i / numSegments, 0);
+			meshData.vertices[topCenter + 1 + i] = Vertex(glm::vec3(x, halfHeight, z), glm::vec3(0, 1, 0), glm::vec2(x, z), glm::vec3(1, 0, 0), -1.0f);
+			meshData.vertices[bottomCenter + 1 + i] = Vertex(glm::vec3(x, -halfHeight, z), glm::vec3(0, -1, 0), glm::vec2(x, z), glm::vec3(1, 0, 0));
+			meshData.vertices[sideStart + i] = Vertex(glm::vec3(x, halfHeight, z), normal, sideUV + glm::vec2(0, 1), tangent, -1.0f);
+			meshData.vertices[sideStart + numSegments + i] = Vertex(glm::vec3(x, -halfHeight, z), normal, sideUV, tangent, -1.0f);
 		}
-		//Side quads
+
+		//Cap patches keep the center as their first vertex, tess.tese relies on it
 		for (int i = 0; i < numSegments; i++)
 		{
-			unsigned int start = sideStartIndex + i;
-			meshData.indices.push_back(start);
-			meshData.indices.push_back(start + 1);
-			meshData.indices.push_back(start + numSegments + 1);
-			meshData.indices.push_back(start + numSegments + 1);
-			meshData.indices.push_back(start + 1);
-			meshData.indices.push_back(start + numSegments + 2);
+			unsigned int next = (i + 1) % numSegments;
+			unsigned int patches[12] = {
+				topCenter, topCenter + 1 + next, topCenter + 1 + i,
+				bottomCenter, bottomCenter + 1 + i, bottomCenter + 1 + next,
+				sideStart + i, sideStart + numSegments + next, sideStart + numSegments + i,
+				sideStart + i, sideStart + next, sideStart + numSegments + next
+			};
+			meshData.indices.insert(meshData.indices.end(), patches, patches + 12);
 		}
 	}
-
 }
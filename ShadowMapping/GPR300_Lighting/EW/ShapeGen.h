@@ -9,4 +9,126 @@ namespace ew {
 	void createCube(float width, float height, float depth, MeshData& meshData);
 	void createSphere(float radius, int numSegments, MeshData& meshData);
 	void createCylinder(float height, float radius, int numSegments, MeshData& meshData);
+	//Subdivided icosahedron. Triangle count is 20 * 4^subdivisions
+	void createIcosphere(float radius, int subdivisions, MeshData& meshData);
+	//Spherified cube, each face is a resolution x resolution grid
+	void createCubeSphere(float radius, int resolution, MeshData& meshData);
+	//Coarse control meshes for shaders/tess.tese, which refines them into a round sphere/cylinder.
+	//Vertices get positions, normals, UVs and tangents, so the coarse mesh draws fine on its own. The evaluation
+	//shader only reads positions and normals, and recomputes UVs on the refined surface
+	void createSphereControlMesh(float radius, MeshData& meshData);
+	void createCylinderControlMesh(float height, float radius, int numSegments, MeshData& meshData);
+
+	//Compile time versions of createPlane, createQuad and createCube. Assign the result to a constexpr and it is
+	//baked into read only memory, Mesh and StaticBatchBuilder read straight from it with no heap allocations
+	constexpr StaticMeshData<4, 6> makePlane(float width, float height)
+	{
+		const float halfWidth = width / 2.0f;
+		const float halfHeight = height / 2.0f;
+		return {
+			{{
+				//Front face
+				Vertex(glm::vec3(-halfWidth, 0, -halfHeight), glm::vec3(0,1,0), glm::vec2(0, 0), glm::vec3(1,0,0), -1.0f), //BL
+				Vertex(glm::vec3(+halfWidth, 0, -halfHeight), glm::vec3(0,1,0), glm::vec2(1, 0), glm::vec3(1,0,0), -1.0f), //BR
+				Vertex(glm::vec3(+halfWidth, 0, +halfHeight), glm::vec3(0,1,0), glm::vec2(1, 1), glm::vec3(1,0,0), -1.0f), //TR
+				Vertex(glm::vec3(-halfWidth, 0, +halfHeight), glm::vec3(0,1,0), glm::vec2(0, 1), glm::vec3(1,0,0), -1.0f), //TL
+			}},
+			{{
+				// front face
+				0, 2, 1,
+				0, 3, 2
+			}}
+		};
+	}
+
+	constexpr StaticMeshData<4, 6> makeQuad(float width, float height)
+	{
+		const float halfWidth = width / 2.0f;
+		const float halfHeight = height / 2.0f;
+		return {
+			{{
+				//Front face
+				Vertex(glm::vec3(-halfWidth, -halfHeight, 0), glm::vec3(0,0,1), glm::vec2(0, 0), glm::vec3(1,0,0)), //BL
+				Vertex(glm::vec3(+halfWidth, -halfHeight, 0), glm::vec3(0,0,1), glm::vec2(1, 0), glm::vec3(1,0,0)), //BR
+				Vertex(glm::vec3(+halfWidth, +halfHeight, 0), glm::vec3(0,0,1), glm::vec2(1, 1), glm::vec3(1,0,0)), //TR
+				Vertex(glm::vec3(-halfWidth, +halfHeight, 0), glm::vec3(0,0,1), glm::vec2(0, 1), glm::vec3(1,0,0)), //TL
+			}},
+			{{
+				// front face
+				0, 1, 2,
+				0, 2, 3
+			}}
+		};
+	}
+
+	constexpr StaticMeshData<24, 36> makeCube(float width, float height, float depth)
+	{
+		const float halfWidth = width / 2.0f;
+		const float halfHeight = height / 2.0f;
+		const float halfDepth = depth / 2.0f;
+		return {
+			{{
+				//Front face
+				Vertex(glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(0, 0), glm::vec3(1,0,0)), //BL
+				Vertex(glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(1, 0), glm::vec3(1,0,0)), //BR
+				Vertex(glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(1, 1), glm::vec3(1,0,0)), //TR
+				Vertex(glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(0, 1), glm::vec3(1,0,0)), //TL
+
+				//Back face
+				Vertex(glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(0, 0), glm::vec3(-1,0,0)), //BL
+				Vertex(glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(1, 0), glm::vec3(-1,0,0)), //BR
+				Vertex(glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(1, 1), glm::vec3(-1,0,0)), //TR
+				Vertex(glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(0, 1), glm::vec3(-1,0,0)), //TL
+
+				//Right face
+				Vertex(glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(1,0,0), glm::vec2(0, 0), glm::vec3(0,0,-1)), //BL
+				Vertex(glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(1,0,0), glm::vec2(1, 0), glm::vec3(0,0,-1)), //BR
+				Vertex(glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(1,0,0), glm::vec2(1, 1), glm::vec3(0,0,-1)), //TR
+				Vertex(glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(1,0,0), glm::vec2(0, 1), glm::vec3(0,0,-1)), //TL
+
+				//Left face
+				Vertex(glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(-1,0,0), glm::vec2(0, 0), glm::vec3(0,0,1)), //BL
+				Vertex(glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(-1,0,0), glm::vec2(1, 0), glm::vec3(0,0,1)), //BR
+				Vertex(glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(-1,0,0), glm::vec2(1, 1), glm::vec3(0,0,1)), //TR
+				Vertex(glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(-1,0,0), glm::vec2(0, 1), glm::vec3(0,0,1)), //TL
+
+				//Top face
+				Vertex(glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(0,1,0), glm::vec2(0, 0), glm::vec3(1,0,0)), //BL
+				Vertex(glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(0,1,0), glm::vec2(1, 0), glm::vec3(1,0,0)), //BR
+				Vertex(glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(0,1,0), glm::vec2(1, 1), glm::vec3(1,0,0)), //TR
+				Vertex(glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(0,1,0), glm::vec2(0, 1), glm::vec3(1,0,0)), //TL
+
+				//Bottom face
+				Vertex(glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(0,-1,0), glm::vec2(0, 0), glm::vec3(1,0,0)), //BL
+				Vertex(glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(0,-1,0), glm::vec2(1, 0), glm::vec3(1,0,0)), //BR
+				Vertex(glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(0,-1,0), glm::vec2(1, 1), glm::vec3(1,0,0)), //TR
+				Vertex(glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(0,-1,0), glm::vec2(0, 1), glm::vec3(1,0,0)), //TL
+			}},
+			{{
+				// front face
+				0, 1, 2,
+				0, 2, 3,
+
+				// back face
+				4, 5, 6,
+				6, 7, 4,
+
+				// right face
+				8,  9, 10,
+				10, 11, 8,
+
+				//left face
+				12, 13, 14,
+				14, 15, 12,
+
+				//top face
+				16,17,18,
+				18,19,16,
+
+				//bottom face
+				20, 21, 22,
+				22, 23, 20
+			}}
+		};
+	}
 }
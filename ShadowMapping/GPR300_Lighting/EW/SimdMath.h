@@ -0,0 +1,92 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//SSE versions of the mat4 products, for hot loops. SSE is always there on x64; building with AVX2
+//enabled (/arch:AVX2, on in the project) switches mulMat4 to computing two columns per instruction.
+//glm matrices are only 4 byte aligned, so everything uses unaligned loads and stores
+namespace ew {
+	//False if the CPU lacks the instruction set the build targets. AVX2 builds need AVX2, the FMA the compiler is
+	//free to emit along with it, and an OS that saves the 256 bit registers. Check once at startup
+	inline bool isBuildSimdSupported()
+	{
+#if defined(__AVX2__) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		return fma && osSavesAvx && avx2;
+#elif defined(__AVX2__)
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return true;
+#endif
+	}
+
+	inline glm::vec4 mulMat4Vec4(const glm::mat4& m, const glm::vec4& v)
+	{
+		const float* a = &m[0][0];
+		__m128 result = _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(v.x));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(a + 4), _mm_set1_ps(v.y)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(a + 8), _mm_set1_ps(v.z)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(a + 12), _mm_set1_ps(v.w)));
+		glm::vec4 out;
+		_mm_storeu_ps(&out.x, result);
+		return out;
+	}
+
+	//m * vec4(p, 1), dropping w. For affine matrices like model matrices
+	inline glm::vec3 transformPoint(const glm::mat4& m, const glm::vec3& p)
+	{
+		const float* a = &m[0][0];
+		__m128 result = _mm_add_ps(_mm_loadu_ps(a + 12), _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(p.x)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(a + 4), _mm_set1_ps(p.y)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(a + 8), _mm_set1_ps(p.z)));
+		float out[4];
+		_mm_storeu_ps(out, result);
+		return glm::vec3(out[0], out[1], out[2]);
+	}
+
+	//a * b. Each result column is a's columns weighted by one column of b
+	inline glm::mat4 mulMat4(const glm::mat4& a, const glm::mat4& b)
+	{
+		const float* pa = &a[0][0];
+		const float* pb = &b[0][0];
+		glm::mat4 out;
+		float* po = &out[0][0];
+#if defined(__AVX2__)
+		//a's columns repeated in both lanes, b's columns two at a time
+		__m256 a0 = _mm256_broadcast_ps((const __m128*)pa);
+		__m256 a1 = _mm256_broadcast_ps((const __m128*)(pa + 4));
+		__m256 a2 = _mm256_broadcast_ps((const __m128*)(pa + 8));
+		__m256 a3 = _mm256_broadcast_ps((const __m128*)(pa + 12));
+		for (int i = 0; i < 16; i += 8) {
+			__m256 columns = _mm256_loadu_ps(pb + i);
+			__m256 result = _mm256_mul_ps(a0, _mm256_permute_ps(columns, 0x00));
+			result = _mm256_add_ps(result, _mm256_mul_ps(a1, _mm256_permute_ps(columns, 0x55)));
+			result = _mm256_add_ps(result, _mm256_mul_ps(a2, _mm256_permute_ps(columns, 0xAA)));
+			result = _mm256_add_ps(result, _mm256_mul_ps(a3, _mm256_permute_ps(columns, 0xFF)));
+			_mm256_storeu_ps(po + i, result);
+		}
+#else
+		__m128 a0 = _mm_loadu_ps(pa);
+		__m128 a1 = _mm_loadu_ps(pa + 4);
+		__m128 a2 = _mm_loadu_ps(pa + 8);
+		__m128 a3 = _mm_loadu_ps(pa + 12);
+		for (int i = 0; i < 16; i += 4) {
+			__m128 column = _mm_loadu_ps(pb + i);
+			__m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(column, column, 0x00));
+			result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(column, column, 0x55)));
+			result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(column, column, 0xAA)));
+			result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(column, column, 0xFF)));
+			_mm_storeu_ps(po + i, result);
+		}
+#endif
+		return out;
+	}
+}
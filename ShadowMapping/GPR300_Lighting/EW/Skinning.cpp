@@ -0,0 +1,215 @@
+#include "Skinning.h"
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+namespace ew {
+	//Matches local_size_x in skinning.comp
+	const int SKINNING_GROUP_SIZE = 64;
+
+	static glm::mat4 composeJoint(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+	{
+		glm::mat3 r = glm::mat3_cast(rotation);
+		return glm::mat4(
+			glm::vec4(r[0] * scale.x, 0.0f),
+			glm::vec4(r[1] * scale.y, 0.0f),
+			glm::vec4(r[2] * scale.z, 0.0f),
+			glm::vec4(position, 1.0f));
+	}
+
+	int Skeleton::addJoint(int parent, const glm::vec3& position, const glm::quat& rotation)
+	{
+		assert(parent < getJointCount() && getJointCount() < MAX_JOINTS);
+		glm::mat4 bind = composeJoint(position, rotation, glm::vec3(1));
+		if (parent >= 0) {
+			bind = glm::inverse(mInverseBindMatrices[parent]) * bind;
+		}
+		mParents.push_back(parent);
+		mBindPositions.push_back(position);
+		mBindRotations.push_back(rotation);
+		mInverseBindMatrices.push_back(glm::inverse(bind));
+		return getJointCount() - 1;
+	}
+
+	void Skeleton::computePalette(const AnimationClip& clip, const glm::vec4* pose, const glm::mat4& world, glm::mat4* outPalette)const
+	{
+		int numJoints = getJointCount();
+		glm::vec3 positions[MAX_JOINTS];
+		glm::quat rotations[MAX_JOINTS];
+		glm::vec3 scales[MAX_JOINTS];
+		for (int i = 0; i < numJoints; i++) {
+			positions[i] = mBindPositions[i];
+			rotations[i] = mBindRotations[i];
+			scales[i] = glm::vec3(1);
+		}
+		int numTracks = clip.getTrackCount();
+		for (int i = 0; i < numTracks; i++) {
+			int joint = clip.getTarget(i);
+			switch (clip.getChannel(i))
+			{
+			case AnimationChannel::Position: positions[joint] = glm::vec3(pose[i]); break;
+			case AnimationChannel::Rotation: rotations[joint] = glm::quat(pose[i].w, pose[i].x, pose[i].y, pose[i].z); break;
+			case AnimationChannel::Scale: scales[joint] = glm::vec3(pose[i]); break;
+			default: break;
+			}
+		}
+		//Joint space to world first, parents are always finished before their children
+		for (int i = 0; i < numJoints; i++) {
+			glm::mat4 local = composeJoint(positions[i], rotations[i], scales[i]);
+			outPalette[i] = (mParents[i] >= 0 ? outPalette[mParents[i]] : world) * local;
+		}
+		for (int i = 0; i < numJoints; i++) {
+			outPalette[i] = outPalette[i] * mInverseBindMatrices[i];
+		}
+	}
+
+	void createSkinnedTube(float height, float radius, int numSegments, int numRings, int numJoints, MeshData& meshData, std::vector<SkinWeights>& skin)
+	{
+		meshData.vertices.clear();
+		meshData.indices.clear();
+		skin.clear();
+		float jointSpacing = height / numJoints;
+		for (int ring = 0; ring <= numRings; ring++) {
+			float v = (float)ring / numRings;
+			float y = v * height;
+			//Blend from the joint below to the one above, everything past the last joint follows it
+			float jointPosition = std::min(y / jointSpacing, (float)(numJoints - 1));
+			int joint = std::min((int)jointPosition, numJoints - 1);
+			float t = jointPosition - joint;
+			SkinWeights weights;
+			weights.joints = glm::uvec4(joint, std::min(joint + 1, numJoints - 1), 0, 0);
+			weights.weights = glm::vec4(1.0f - t, t, 0, 0);
+			for (int segment = 0; segment <= numSegments; segment++) {
+				float u = (float)segment / numSegments;
+				float theta = u * 2.0f * glm::pi<float>();
+				glm::vec3 normal = glm::vec3(cos(theta), 0, sin(theta));
+				glm::vec3 tangent = glm::vec3(-sin(theta), 0, cos(theta));
+				//cross(normal, tangent) points down, V runs up
+				meshData.vertices.push_back(Vertex(glm::vec3(normal.x * radius, y, normal.z * radius), normal, glm::vec2(u, v), tangent, -1.0f));
+				skin.push_back(weights);
+			}
+		}
+		int ringVertexCount = numSegments + 1;
+		for (int ring = 0; ring < numRings; ring++) {
+			for (int segment = 0; segment < numSegments; segment++) {
+				unsigned int a = ring * ringVertexCount + segment;
+				unsigned int b = a + 1;
+				unsigned int c = a + ringVertexCount;
+				unsigned int d = c + 1;
+				meshData.indices.push_back(a);
+				meshData.indices.push_back(c);
+				meshData.indices.push_back(b);
+				meshData.indices.push_back(b);
+				meshData.indices.push_back(c);
+				meshData.indices.push_back(d);
+			}
+		}
+	}
+
+	SkinnedMeshBatch::SkinnedMeshBatch(const MeshDataView& bindMesh, const std::vector<SkinWeights>& skin, int numJoints, int maxInstances)
+		: mNumVertices((int)bindMesh.numVertices), mNumIndices((int)bindMesh.numIndices), mNumJoints(numJoints), mMaxInstances(maxInstances)
+	{
+		assert(skin.size() == bindMesh.numVertices);
+		//Inputs are read only to the GPU, only palettes change after this
+		glGenBuffers(1, &mBindVertexBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBindVertexBuffer);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, mNumVertices * sizeof(Vertex), bindMesh.vertices, 0);
+		glGenBuffers(1, &mSkinBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSkinBuffer);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, mNumVertices * sizeof(SkinWeights), skin.data(), 0);
+		glGenBuffers(1, &mPaletteBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mPaletteBuffer);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, maxInstances * numJoints * sizeof(glm::mat4), NULL, GL_DYNAMIC_STORAGE_BIT);
+		//Real + dual part per joint
+		glGenBuffers(1, &mDualQuaternionBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDualQuaternionBuffer);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, maxInstances * numJoints * 2 * sizeof(glm::vec4), NULL, GL_DYNAMIC_STORAGE_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		//Skinned vertices of instance i start at i * numVertices, and every instance reuses the bind mesh's indices
+		glGenVertexArrays(1, &mVAO);
+		glBindVertexArray(mVAO);
+		glGenBuffers(1, &mOutputVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, mOutputVBO);
+		glBufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)maxInstances * mNumVertices * sizeof(Vertex), NULL, 0);
+		glGenBuffers(1, &mEBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+		glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, mNumIndices * sizeof(unsigned int), bindMesh.indices, 0);
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, position)));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, normal)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, UV)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, tangent)));
+		glEnableVertexAttribArray(3);
+		glBindVertexArray(0);
+
+		mIndexCounts.assign(maxInstances, (GLsizei)mNumIndices);
+		mIndexOffsets.assign(maxInstances, nullptr);
+		mBaseVertices.resize(maxInstances);
+		for (int i = 0; i < maxInstances; i++) {
+			mBaseVertices[i] = i * mNumVertices;
+		}
+	}
+
+	SkinnedMeshBatch::~SkinnedMeshBatch()
+	{
+		glDeleteVertexArrays(1, &mVAO);
+		GLuint buffers[] = { mOutputVBO, mEBO, mBindVertexBuffer, mSkinBuffer, mPaletteBuffer, mDualQuaternionBuffer };
+		glDeleteBuffers(6, buffers);
+	}
+
+	void SkinnedMeshBatch::setPalettes(const std::vector<glm::mat4>& palettes, bool dualQuaternion)
+	{
+		mInstanceCount = std::min((int)palettes.size() / mNumJoints, mMaxInstances);
+		mDualQuaternion = dualQuaternion;
+		int numMatrices = mInstanceCount * mNumJoints;
+		if (!dualQuaternion) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, mPaletteBuffer);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numMatrices * sizeof(glm::mat4), palettes.data());
+			return;
+		}
+		//Half the upload of matrices. Rotation comes from the upper 3x3, so it has to be rigid
+		mDualQuaternions.resize(numMatrices * 2);
+		for (int i = 0; i < numMatrices; i++) {
+			const glm::mat4& m = palettes[i];
+			glm::quat real = glm::normalize(glm::quat_cast(glm::mat3(m)));
+			glm::quat dual = glm::quat(0.0f, m[3].x, m[3].y, m[3].z) * real * 0.5f;
+			mDualQuaternions[i * 2] = glm::vec4(real.x, real.y, real.z, real.w);
+			mDualQuaternions[i * 2 + 1] = glm::vec4(dual.x, dual.y, dual.z, dual.w);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDualQuaternionBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numMatrices * 2 * sizeof(glm::vec4), mDualQuaternions.data());
+	}
+
+	void SkinnedMeshBatch::skin(Shader& skinningShader)
+	{
+		if (mInstanceCount == 0) {
+			return;
+		}
+		skinningShader.use();
+		skinningShader.setInt("_NumVertices", mNumVertices);
+		skinningShader.setInt("_NumJoints", mNumJoints);
+		skinningShader.setInt("_DualQuaternion", mDualQuaternion ? 1 : 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mBindVertexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mSkinBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mPaletteBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mDualQuaternionBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, mOutputVBO);
+		//x covers the vertices, y is the instance
+		glDispatchCompute((GLuint)((mNumVertices + SKINNING_GROUP_SIZE - 1) / SKINNING_GROUP_SIZE), (GLuint)mInstanceCount, 1);
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	}
+
+	void SkinnedMeshBatch::draw()
+	{
+		if (mInstanceCount == 0) {
+			return;
+		}
+		glBindVertexArray(mVAO);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, mIndexCounts.data(), GL_UNSIGNED_INT, mIndexOffsets.data(), mInstanceCount, mBaseVertices.data());
+		glBindVertexArray(0);
+	}
+}
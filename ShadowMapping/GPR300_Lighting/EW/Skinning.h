@@ -0,0 +1,77 @@
+#pragma once
+#include "Mesh.h"
+#include "Shader.h"
+#include "Animation.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Per vertex skin data, kept in its own stream next to the regular ew::Vertex so unskinned meshes don't pay for it.
+	/// Up to 4 joints per vertex, weights should add up to 1. Layout matches SkinWeights in shaders/skinning.comp
+	/// </summary>
+	struct SkinWeights {
+		glm::vec4 weights = glm::vec4(0);
+		glm::uvec4 joints = glm::uvec4(0);
+	};
+
+	/// <summary>
+	/// Joint hierarchy in bind pose. Parents have to be added before their children, so the palette can be built in one forward pass
+	/// </summary>
+	class Skeleton {
+	public:
+		//Local bind transform relative to parent. Returns the joint index
+		int addJoint(int parent, const glm::vec3& position, const glm::quat& rotation = glm::quat(1, 0, 0, 0));
+		//Builds world * joint * inverse bind for every joint. Tracks of clip drive the joint in their target,
+		//joints without tracks stay in bind pose. pose is sampled from clip, see AnimationPlayer
+		void computePalette(const AnimationClip& clip, const glm::vec4* pose, const glm::mat4& world, glm::mat4* outPalette)const;
+		inline int getJointCount()const { return (int)mParents.size(); }
+		inline int getParent(int joint)const { return mParents[joint]; }
+
+		static constexpr int MAX_JOINTS = 64;
+	private:
+		std::vector<int> mParents;
+		std::vector<glm::vec3> mBindPositions;
+		std::vector<glm::quat> mBindRotations;
+		std::vector<glm::mat4> mInverseBindMatrices;
+	};
+
+	//Open tube standing on the origin, going up Y, rigged to numJoints joints spaced evenly from y = 0.
+	//Each vertex is weighted between the two joints around it. Joint j sits at y = j * height / numJoints
+	void createSkinnedTube(float height, float radius, int numSegments, int numRings, int numJoints, MeshData& meshData, std::vector<SkinWeights>& skin);
+
+	/// <summary>
+	/// Many instances of one skinned mesh, skinned by shaders/skinning.comp into a single vertex buffer once per frame.
+	/// The output is plain ew::Vertex in world space (the instance transform is part of its palette), so the depth
+	/// and lit passes both draw it with their regular shaders and an identity model matrix, and nothing is skinned twice.
+	/// Dual quaternion skinning only supports rigid joints, scale in a palette is dropped
+	/// </summary>
+	class SkinnedMeshBatch {
+	public:
+		SkinnedMeshBatch(const MeshDataView& bindMesh, const std::vector<SkinWeights>& skin, int numJoints, int maxInstances);
+		~SkinnedMeshBatch();
+		//numJoints matrices per instance, back to back. Instance count is palettes.size() / numJoints
+		void setPalettes(const std::vector<glm::mat4>& palettes, bool dualQuaternion);
+		//Dispatches the skinning shader over every vertex of every instance
+		void skin(Shader& skinningShader);
+		//All instances in one multi draw
+		void draw();
+		inline int getInstanceCount()const { return mInstanceCount; }
+		inline int getMaxInstances()const { return mMaxInstances; }
+		inline int getNumJoints()const { return mNumJoints; }
+		inline int getSkinnedVertexCount()const { return mInstanceCount * mNumVertices; }
+	private:
+		SkinnedMeshBatch(const SkinnedMeshBatch& r) = delete;
+		GLuint mVAO = 0, mOutputVBO = 0, mEBO = 0;
+		GLuint mBindVertexBuffer = 0, mSkinBuffer = 0, mPaletteBuffer = 0, mDualQuaternionBuffer = 0;
+		int mNumVertices, mNumIndices, mNumJoints, mMaxInstances;
+		int mInstanceCount = 0;
+		bool mDualQuaternion = false;
+		std::vector<glm::vec4> mDualQuaternions;
+		//Per instance draw arguments for glMultiDrawElementsBaseVertex, filled once
+		std::vector<GLsizei> mIndexCounts;
+		std::vector<void*> mIndexOffsets;
+		std::vector<GLint> mBaseVertices;
+	};
+}
@@ -0,0 +1,127 @@
+#include "StaticBatch.h"
+#include "SimdMath.h"
+#include <glm/gtc/matrix_inverse.hpp>
+#include <cfloat>
+
+namespace ew {
+	int StaticBatchBuilder::add(const MeshDataView& meshData, const glm::mat4& model)
+	{
+		mEntries.push_back({ meshData, model });
+		return (int)mEntries.size() - 1;
+	}
+
+	void StaticBatchBuilder::build(MeshData& outMeshData, std::vector<BatchRange>& outRanges) const
+	{
+		outMeshData.vertices.clear();
+		outMeshData.indices.clear();
+		outRanges.clear();
+
+		//Size everything up front so baking never reallocates
+		size_t numVertices = 0, numIndices = 0;
+		for (const Entry& entry : mEntries) {
+			numVertices += entry.meshData.numVertices;
+			numIndices += entry.meshData.numIndices;
+		}
+		outMeshData.vertices.reserve(numVertices);
+		outMeshData.indices.reserve(numIndices);
+		outRanges.reserve(mEntries.size());
+
+		for (const Entry& entry : mEntries) {
+			//Normals need the inverse transpose so non uniform scale doesn't skew them
+			glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(entry.model));
+			glm::mat3 tangentMatrix = glm::mat3(entry.model);
+			unsigned int baseVertex = (unsigned int)outMeshData.vertices.size();
+
+			BatchRange range;
+			range.firstIndex = (unsigned int)outMeshData.indices.size();
+			range.indexCount = (unsigned int)entry.meshData.numIndices;
+			range.boundsMin = glm::vec3(FLT_MAX);
+			range.boundsMax = glm::vec3(-FLT_MAX);
+
+			for (size_t i = 0; i < entry.meshData.numVertices; i++) {
+				const Vertex& v = entry.meshData.vertices[i];
+				glm::vec3 position = transformPoint(entry.model, v.position);
+				glm::vec3 normal = glm::normalize(normalMatrix * v.normal);
+				glm::vec3 tangent = glm::normalize(tangentMatrix * glm::vec3(v.tangent));
+				//Mirroring transforms flip handedness
+				float bitangentSign = glm::determinant(tangentMatrix) < 0.0f ? -v.tangent.w : v.tangent.w;
+				outMeshData.vertices.push_back(Vertex(position, normal, v.UV, tangent, bitangentSign));
+				range.boundsMin = glm::min(range.boundsMin, position);
+				range.boundsMax = glm::max(range.boundsMax, position);
+			}
+			for (size_t i = 0; i < entry.meshData.numIndices; i++) {
+				outMeshData.indices.push_back(baseVertex + entry.meshData.indices[i]);
+			}
+			outRanges.push_back(range);
+		}
+	}
+
+	void StaticBatchBuilder::clear()
+	{
+		mEntries.clear();
+	}
+
+	StaticBatch::StaticBatch(const StaticBatchBuilder& builder)
+	{
+		MeshData meshData;
+		builder.build(meshData, mRanges);
+		mMesh = new Mesh(&meshData);
+	}
+
+	StaticBatch::~StaticBatch()
+	{
+		delete mMesh;
+	}
+
+	void StaticBatch::draw()
+	{
+		mMesh->draw();
+		mLastDrawCount = 1;
+		mLastTriangleCount = getNumTriangles();
+	}
+
+	void StaticBatch::draw(const std::vector<bool>& visible)
+	{
+		mLastDrawCount = 0;
+		mLastTriangleCount = 0;
+		size_t numRanges = mRanges.size();
+		size_t i = 0;
+		while (i < numRanges) {
+			if (!visible[i]) {
+				i++;
+				continue;
+			}
+			//Ranges are laid out back to back, so a run of visible objects is one contiguous draw
+			unsigned int first = mRanges[i].firstIndex;
+			unsigned int count = 0;
+			while (i < numRanges && visible[i]) {
+				count += mRanges[i].indexCount;
+				i++;
+			}
+			mMesh->drawRange(first, (GLsizei)count);
+			mLastDrawCount++;
+			mLastTriangleCount += count / 3;
+		}
+	}
+
+	void StaticBatch::draw(const std::vector<int>& visibleIds)
+	{
+		mLastDrawCount = 0;
+		mLastTriangleCount = 0;
+		size_t numVisible = visibleIds.size();
+		size_t i = 0;
+		while (i < numVisible) {
+			//Consecutive ids are neighbouring ranges
+			unsigned int first = mRanges[visibleIds[i]].firstIndex;
+			unsigned int count = mRanges[visibleIds[i]].indexCount;
+			i++;
+			while (i < numVisible && visibleIds[i] == visibleIds[i - 1] + 1) {
+				count += mRanges[visibleIds[i]].indexCount;
+				i++;
+			}
+			mMesh->drawRange(first, (GLsizei)count);
+			mLastDrawCount++;
+			mLastTriangleCount += count / 3;
+		}
+	}
+}
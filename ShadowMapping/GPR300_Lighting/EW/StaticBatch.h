@@ -0,0 +1,90 @@
+#pragma once
+#include "Mesh.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace ew {
+	/// <summary>
+	/// Index range + world space bounds of one object baked into a static batch
+	/// </summary>
+	struct BatchRange {
+		unsigned int firstIndex;
+		unsigned int indexCount;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	/// <summary>
+	/// Collects meshes that never move along with their model matrices.
+	/// Mesh data is referenced, not copied, so it must outlive build()
+	/// </summary>
+	class StaticBatchBuilder {
+	public:
+		//Returns the sub object index, which is also its index into the built ranges
+		int add(const MeshDataView& meshData, const glm::mat4& model);
+		//Bakes every transform into the vertices and appends all meshes into one MeshData
+		void build(MeshData& outMeshData, std::vector<BatchRange>& outRanges) const;
+		void clear();
+		inline int getObjectCount()const { return (int)mEntries.size(); }
+	private:
+		struct Entry {
+			MeshDataView meshData;
+			glm::mat4 model;
+		};
+		std::vector<Entry> mEntries;
+	};
+
+	/// <summary>
+	/// One merged mesh for a set of static objects. Draw with an identity model matrix.
+	/// </summary>
+	class StaticBatch {
+	public:
+		StaticBatch(const StaticBatchBuilder& builder);
+		~StaticBatch();
+		//Draws every object in one call
+		void draw();
+		//Draws only visible[i] objects, merging neighbouring visible ranges into one draw
+		void draw(const std::vector<bool>& visible);
+		//Same for a compact list of visible object indices in increasing order, like CullingBounds::cull makes
+		void draw(const std::vector<int>& visibleIds);
+		//Same again, but neighbours only merge if they have the same key in keysById, and onRun(key) is called
+		//before each draw to set up whatever the key stands for
+		template<typename OnRun>
+		void draw(const std::vector<int>& visibleIds, const uint64_t* keysById, OnRun onRun);
+		inline const std::vector<BatchRange>& getRanges()const { return mRanges; }
+		//Number of glDrawElements calls made by the last draw
+		inline int getLastDrawCount()const { return mLastDrawCount; }
+		inline int getLastTriangleCount()const { return mLastTriangleCount; }
+		inline int getNumTriangles()const { return mMesh->getNumIndices() / 3; }
+	private:
+		StaticBatch(const StaticBatch& r) = delete;
+		Mesh* mMesh;
+		std::vector<BatchRange> mRanges;
+		int mLastDrawCount = 0;
+		int mLastTriangleCount = 0;
+	};
+
+	template<typename OnRun>
+	void StaticBatch::draw(const std::vector<int>& visibleIds, const uint64_t* keysById, OnRun onRun)
+	{
+		mLastDrawCount = 0;
+		mLastTriangleCount = 0;
+		size_t numVisible = visibleIds.size();
+		size_t i = 0;
+		while (i < numVisible) {
+			uint64_t key = keysById[visibleIds[i]];
+			unsigned int first = mRanges[visibleIds[i]].firstIndex;
+			unsigned int count = mRanges[visibleIds[i]].indexCount;
+			i++;
+			while (i < numVisible && visibleIds[i] == visibleIds[i - 1] + 1 && keysById[visibleIds[i]] == key) {
+				count += mRanges[visibleIds[i]].indexCount;
+				i++;
+			}
+			onRun(key);
+			mMesh->drawRange(first, (GLsizei)count);
+			mLastDrawCount++;
+			mLastTriangleCount += count / 3;
+		}
+	}
+}
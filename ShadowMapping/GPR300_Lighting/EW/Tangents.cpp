@@ -0,0 +1,111 @@
+#include "Tangents.h"
+#include "Parallel.h"
+
+namespace ew {
+	//Below this many triangles per thread, spinning up another accumulation buffer costs more than it saves
+	const int MIN_TRIANGLES_PER_THREAD = 16384;
+
+	static glm::vec3 projectOnPlane(const glm::vec3& v, const glm::vec3& n)
+	{
+		return v - n * glm::dot(n, v);
+	}
+
+	static glm::vec3 safeNormalize(const glm::vec3& v)
+	{
+		float lengthSq = glm::dot(v, v);
+		return lengthSq > 1e-20f ? v / sqrtf(lengthSq) : glm::vec3(0);
+	}
+
+	//Any unit vector perpendicular to n, for vertices whose UVs give no usable direction
+	static glm::vec3 anyPerpendicular(const glm::vec3& n)
+	{
+		glm::vec3 axis = fabsf(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+		return glm::normalize(glm::cross(n, axis));
+	}
+
+	void generateTangents(MeshData& meshData)
+	{
+		int numVertices = (int)meshData.vertices.size();
+		int numTriangles = (int)(meshData.indices.size() / 3);
+		if (numVertices == 0 || numTriangles == 0) {
+			return;
+		}
+		Vertex* vertices = meshData.vertices.data();
+		const unsigned int* indices = meshData.indices.data();
+
+		//One tangent + bitangent accumulator per vertex per thread, so threads never write to shared memory
+		int numBuffers = std::min(getWorkerCount(), std::max(1, numTriangles / MIN_TRIANGLES_PER_THREAD));
+		int trianglesPerBuffer = (numTriangles + numBuffers - 1) / numBuffers;
+		std::vector<std::vector<glm::vec3>> tangentBuffers(numBuffers);
+		std::vector<std::vector<glm::vec3>> bitangentBuffers(numBuffers);
+
+		parallelFor(numBuffers, 1, [&](int beginBuffer, int endBuffer) {
+			for (int b = beginBuffer; b < endBuffer; b++)
+			{
+				std::vector<glm::vec3>& tangents = tangentBuffers[b];
+				std::vector<glm::vec3>& bitangents = bitangentBuffers[b];
+				tangents.assign(numVertices, glm::vec3(0));
+				bitangents.assign(numVertices, glm::vec3(0));
+
+				int end = std::min(numTriangles, (b + 1) * trianglesPerBuffer);
+				for (int t = b * trianglesPerBuffer; t < end; t++)
+				{
+					const unsigned int* tri = indices + t * 3;
+					const Vertex& v0 = vertices[tri[0]];
+					const Vertex& v1 = vertices[tri[1]];
+					const Vertex& v2 = vertices[tri[2]];
+
+					glm::vec3 edge1 = v1.position - v0.position;
+					glm::vec3 edge2 = v2.position - v0.position;
+					glm::vec2 deltaUV1 = v1.UV - v0.UV;
+					glm::vec2 deltaUV2 = v2.UV - v0.UV;
+					float signedUVArea = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+					if (fabsf(signedUVArea) < 1e-20f) {
+						continue;
+					}
+
+					//Like MikkTSpace, only the direction of the triangle's tangent frame matters, not its UV scale
+					float orientation = signedUVArea > 0.0f ? 1.0f : -1.0f;
+					glm::vec3 faceTangent = safeNormalize(edge1 * deltaUV2.y - edge2 * deltaUV1.y) * orientation;
+					glm::vec3 faceBitangent = safeNormalize(edge2 * deltaUV1.x - edge1 * deltaUV2.x) * orientation;
+
+					for (int corner = 0; corner < 3; corner++)
+					{
+						unsigned int index = tri[corner];
+						const glm::vec3& n = vertices[index].normal;
+						const glm::vec3& p = vertices[index].position;
+
+						//Corner angle measured in the vertex's tangent plane
+						glm::vec3 toNext = safeNormalize(projectOnPlane(vertices[tri[(corner + 1) % 3]].position - p, n));
+						glm::vec3 toPrev = safeNormalize(projectOnPlane(vertices[tri[(corner + 2) % 3]].position - p, n));
+						float angle = acosf(glm::clamp(glm::dot(toNext, toPrev), -1.0f, 1.0f));
+
+						tangents[index] += safeNormalize(projectOnPlane(faceTangent, n)) * angle;
+						bitangents[index] += safeNormalize(projectOnPlane(faceBitangent, n)) * angle;
+					}
+				}
+			}
+		});
+
+		//Sum the per thread buffers and orthonormalize against the normal
+		parallelFor(numVertices, 4096, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				glm::vec3 tangent = tangentBuffers[0][i];
+				glm::vec3 bitangent = bitangentBuffers[0][i];
+				for (int b = 1; b < numBuffers; b++) {
+					tangent += tangentBuffers[b][i];
+					bitangent += bitangentBuffers[b][i];
+				}
+
+				const glm::vec3& n = vertices[i].normal;
+				tangent = safeNormalize(projectOnPlane(tangent, n));
+				if (tangent == glm::vec3(0)) {
+					tangent = anyPerpendicular(n);
+				}
+				float bitangentSign = glm::dot(glm::cross(n, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+				vertices[i].tangent = glm::vec4(tangent, bitangentSign);
+			}
+		});
+	}
+}
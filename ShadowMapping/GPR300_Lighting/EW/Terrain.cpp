@@ -0,0 +1,422 @@
+#include "Terrain.h"
+#include "Parallel.h"
+#include "Shader.h"
+#include <algorithm>
+#include <utility>
+
+namespace ew {
+	//Neighbour sides, used as bits in the stitch mask
+	const int SIDE_LEFT = 1;	//-X
+	const int SIDE_RIGHT = 2;	//+X
+	const int SIDE_BOTTOM = 4;	//-Z
+	const int SIDE_TOP = 8;		//+Z
+
+	static float hash2D(int x, int z, unsigned int seed)
+	{
+		unsigned int h = (unsigned int)x * 374761393u + (unsigned int)z * 668265263u + seed * 2246822519u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		h ^= h >> 16;
+		return (float)(h & 0xffffff) / (float)0xffffff;
+	}
+
+	static float valueNoise(float x, float z, unsigned int seed)
+	{
+		float fx = floorf(x), fz = floorf(z);
+		int ix = (int)fx, iz = (int)fz;
+		float tx = x - fx, tz = z - fz;
+		tx = tx * tx * (3.0f - 2.0f * tx);
+		tz = tz * tz * (3.0f - 2.0f * tz);
+		float bottom = glm::mix(hash2D(ix, iz, seed), hash2D(ix + 1, iz, seed), tx);
+		float top = glm::mix(hash2D(ix, iz + 1, seed), hash2D(ix + 1, iz + 1, seed), tx);
+		return glm::mix(bottom, top, tz);
+	}
+
+	Terrain::Terrain(const TerrainSettings& settings)
+		: mSettings(settings), mJobs(std::max(1, getWorkerCount() - 1))
+	{
+		mChunksPerSide = (int)(settings.worldSize / settings.chunkSize);
+		mChunkSlots.assign(mChunksPerSide * mChunksPerSide, -1);
+		mChunkLods.assign(mChunksPerSide * mChunksPerSide, MAX_LOD);
+
+		buildIndexBuffer();
+
+		//Every slot is allocated once at full size and only ever updated after this, either by
+		//glBufferSubData from the workers' results or by the chunk compute shader
+		GLsizeiptr chunkBytes = CHUNK_VERTICES * CHUNK_VERTICES * sizeof(Vertex);
+		mSlots.resize(settings.maxResidentChunks);
+		for (int i = 0; i < settings.maxResidentChunks; i++)
+		{
+			ChunkSlot& slot = mSlots[i];
+			glGenVertexArrays(1, &slot.vao);
+			glBindVertexArray(slot.vao);
+
+			glGenBuffers(1, &slot.vbo);
+			glBindBuffer(GL_ARRAY_BUFFER, slot.vbo);
+			glBufferStorage(GL_ARRAY_BUFFER, chunkBytes, NULL, GL_DYNAMIC_STORAGE_BIT);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, position)));
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, normal)));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, UV)));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, tangent)));
+			glEnableVertexAttribArray(3);
+
+			mFreeSlots.push_back(settings.maxResidentChunks - 1 - i);
+		}
+		glBindVertexArray(0);
+		mGpuMemoryBytes += chunkBytes * settings.maxResidentChunks;
+	}
+
+	Terrain::~Terrain()
+	{
+		for (ChunkSlot& slot : mSlots) {
+			glDeleteVertexArrays(1, &slot.vao);
+			glDeleteBuffers(1, &slot.vbo);
+		}
+		glDeleteBuffers(1, &mEBO);
+	}
+
+	float Terrain::getHeight(float x, float z)const
+	{
+		float amplitude = 1.0f;
+		float frequency = 1.0f / mSettings.noiseScale;
+		float height = 0.0f;
+		float totalAmplitude = 0.0f;
+		for (int octave = 0; octave < 6; octave++)
+		{
+			height += valueNoise(x * frequency, z * frequency, mSettings.seed + octave) * amplitude;
+			totalAmplitude += amplitude;
+			amplitude *= 0.5f;
+			frequency *= 2.0f;
+		}
+		float flatten = glm::smoothstep(mSettings.flatRadius, mSettings.flatRadius * 5.0f, sqrtf(x * x + z * z));
+		return mSettings.baseHeight + (height / totalAmplitude) * mSettings.heightScale * flatten;
+	}
+
+	//Each LOD is triangulated as 2x2 quad blocks fanned around their center. When a neighbour is one LOD coarser,
+	//the block edge midpoints along that side are skipped so the edge matches the neighbour's vertices exactly.
+	void Terrain::buildIndexBuffer()
+	{
+		//Block ring, CCW seen from above
+		const int ring[8][2] = { {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1} };
+
+		std::vector<unsigned int> indices;
+		for (int lod = 0; lod <= MAX_LOD; lod++)
+		{
+			int step = 1 << lod;
+			int numBlocks = CHUNK_QUADS / (step * 2);
+			for (int mask = 0; mask < 16; mask++)
+			{
+				mIndexRanges[lod][mask].firstIndex = (unsigned int)indices.size();
+				for (int bz = 0; bz < numBlocks; bz++)
+				{
+					for (int bx = 0; bx < numBlocks; bx++)
+					{
+						int centerX = bx * step * 2 + step;
+						int centerZ = bz * step * 2 + step;
+						unsigned int center = centerZ * CHUNK_VERTICES + centerX;
+
+						unsigned int fan[8];
+						int fanSize = 0;
+						for (int i = 0; i < 8; i++)
+						{
+							int dx = ring[i][0], dz = ring[i][1];
+							bool stitched = (dx == -1 && dz == 0 && bx == 0 && (mask & SIDE_LEFT))
+								|| (dx == 1 && dz == 0 && bx == numBlocks - 1 && (mask & SIDE_RIGHT))
+								|| (dx == 0 && dz == -1 && bz == 0 && (mask & SIDE_BOTTOM))
+								|| (dx == 0 && dz == 1 && bz == numBlocks - 1 && (mask & SIDE_TOP));
+							if (!stitched) {
+								fan[fanSize++] = (centerZ + dz * step) * CHUNK_VERTICES + (centerX + dx * step);
+							}
+						}
+						for (int i = 0; i < fanSize; i++)
+						{
+							indices.push_back(center);
+							indices.push_back(fan[i]);
+							indices.push_back(fan[(i + 1) % fanSize]);
+						}
+					}
+				}
+				mIndexRanges[lod][mask].indexCount = (unsigned int)indices.size() - mIndexRanges[lod][mask].firstIndex;
+			}
+		}
+
+		glGenBuffers(1, &mEBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+		mGpuMemoryBytes += indices.size() * sizeof(unsigned int);
+	}
+
+	glm::vec2 Terrain::getChunkOrigin(int chunk)const
+	{
+		return glm::vec2(chunk % mChunksPerSide, chunk / mChunksPerSide) * mSettings.chunkSize - mSettings.worldSize * 0.5f;
+	}
+
+	void Terrain::generateChunk(int chunk, std::vector<Vertex>& vertices)const
+	{
+		float spacing = mSettings.chunkSize / CHUNK_QUADS;
+		glm::vec2 origin = getChunkOrigin(chunk);
+		float originX = origin.x, originZ = origin.y;
+
+		//Heights with a one sample border, so normals at the chunk edge match the neighbouring chunk
+		const int heightsPerSide = CHUNK_VERTICES + 2;
+		std::vector<float> heights(heightsPerSide * heightsPerSide);
+		for (int z = 0; z < heightsPerSide; z++) {
+			for (int x = 0; x < heightsPerSide; x++) {
+				heights[z * heightsPerSide + x] = getHeight(originX + (x - 1) * spacing, originZ + (z - 1) * spacing);
+			}
+		}
+
+		vertices.resize(CHUNK_VERTICES * CHUNK_VERTICES);
+		for (int z = 0; z < CHUNK_VERTICES; z++)
+		{
+			for (int x = 0; x < CHUNK_VERTICES; x++)
+			{
+				const float* h = &heights[(z + 1) * heightsPerSide + (x + 1)];
+				float slopeX = h[1] - h[-1];
+				float slopeZ = h[heightsPerSide] - h[-heightsPerSide];
+				glm::vec3 position = glm::vec3(originX + x * spacing, h[0], originZ + z * spacing);
+				glm::vec3 normal = glm::normalize(glm::vec3(-slopeX, 2.0f * spacing, -slopeZ));
+				glm::vec3 tangent = glm::normalize(glm::vec3(2.0f * spacing, slopeX, 0));
+				tangent = glm::normalize(tangent - normal * glm::dot(normal, tangent));
+				//UVs run along +X and +Z like createPlane, so the bitangent sign is -1
+				vertices[z * CHUNK_VERTICES + x] = Vertex(position, normal, glm::vec2(position.x, position.z) / mSettings.uvScale, tangent, -1.0f);
+			}
+		}
+	}
+
+	void Terrain::setGpuGenerator(Shader* chunkShader)
+	{
+		mChunkShader = chunkShader;
+		if (!mChunkShader) {
+			return;
+		}
+		mChunkShader->use();
+		mChunkShader->setFloat("_Spacing", mSettings.chunkSize / CHUNK_QUADS);
+		mChunkShader->setInt("_ChunkVertices", CHUNK_VERTICES);
+		mChunkShader->setFloat("_NoiseScale", mSettings.noiseScale);
+		mChunkShader->setFloat("_HeightScale", mSettings.heightScale);
+		mChunkShader->setFloat("_BaseHeight", mSettings.baseHeight);
+		mChunkShader->setFloat("_FlatRadius", mSettings.flatRadius);
+		mChunkShader->setFloat("_UVScale", mSettings.uvScale);
+		mChunkShader->setInt("_Seed", (int)mSettings.seed);
+	}
+
+	//Expects the chunk shader to be in use. The caller issues the memory barrier once for all chunks dispatched this frame
+	void Terrain::generateChunkGpu(int chunk, ChunkSlot& slot)
+	{
+		mChunkShader->setVec2("_Origin", getChunkOrigin(chunk));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, slot.vbo);
+		GLuint numGroups = (CHUNK_VERTICES + 7) / 8;
+		glDispatchCompute(numGroups, numGroups, 1);
+		slot.ready = true;
+	}
+
+	int Terrain::getChunkLod(int chunk)const
+	{
+		return mChunkLods[chunk];
+	}
+
+	void Terrain::update(const glm::vec3& cameraPosition)
+	{
+		//UPLOAD
+		std::vector<CompletedChunk> completed;
+		{
+			std::lock_guard<std::mutex> lock(mCompletedMutex);
+			completed.swap(mCompleted);
+		}
+		for (CompletedChunk& result : completed)
+		{
+			ChunkSlot& slot = mSlots[result.slot];
+			if (slot.version != result.version) {
+				continue;
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, slot.vbo);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, result.vertices.size() * sizeof(Vertex), result.vertices.data());
+			slot.ready = true;
+		}
+
+		//STREAMING
+		//Closest chunks within view distance, up to the pool size
+		float halfWorld = mSettings.worldSize * 0.5f;
+		std::vector<std::pair<float, int>> candidates;
+		int minX = std::max(0, (int)((cameraPosition.x - mSettings.viewDistance + halfWorld) / mSettings.chunkSize));
+		int maxX = std::min(mChunksPerSide - 1, (int)((cameraPosition.x + mSettings.viewDistance + halfWorld) / mSettings.chunkSize));
+		int minZ = std::max(0, (int)((cameraPosition.z - mSettings.viewDistance + halfWorld) / mSettings.chunkSize));
+		int maxZ = std::min(mChunksPerSide - 1, (int)((cameraPosition.z + mSettings.viewDistance + halfWorld) / mSettings.chunkSize));
+		for (int z = minZ; z <= maxZ; z++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				glm::vec2 chunkMin = glm::vec2(x, z) * mSettings.chunkSize - halfWorld;
+				glm::vec2 closest = glm::clamp(glm::vec2(cameraPosition.x, cameraPosition.z), chunkMin, chunkMin + mSettings.chunkSize);
+				float distance = glm::length(glm::vec3(closest.x, cameraPosition.y, closest.y) - cameraPosition);
+				if (distance <= mSettings.viewDistance) {
+					candidates.push_back({ distance, z * mChunksPerSide + x });
+				}
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		if ((int)candidates.size() > mSettings.maxResidentChunks) {
+			candidates.resize(mSettings.maxResidentChunks);
+		}
+
+		std::vector<bool> desired(mChunkSlots.size(), false);
+		for (const std::pair<float, int>& candidate : candidates) {
+			desired[candidate.second] = true;
+		}
+
+		//Free slots whose chunk went out of range. Any generation still in flight for it gets dropped on arrival
+		for (int i = 0; i < (int)mSlots.size(); i++)
+		{
+			ChunkSlot& slot = mSlots[i];
+			if (slot.chunk >= 0 && !desired[slot.chunk]) {
+				mChunkSlots[slot.chunk] = -1;
+				slot.chunk = -1;
+				slot.ready = false;
+				slot.version++;
+				mFreeSlots.push_back(i);
+			}
+		}
+
+		//Nearest chunks are queued first
+		if (mChunkShader) {
+			mChunkShader->use();
+		}
+		bool dispatched = false;
+		for (const std::pair<float, int>& candidate : candidates)
+		{
+			int chunk = candidate.second;
+			if (mChunkSlots[chunk] >= 0 || mFreeSlots.empty()) {
+				continue;
+			}
+			int slotIndex = mFreeSlots.back();
+			mFreeSlots.pop_back();
+			ChunkSlot& slot = mSlots[slotIndex];
+			slot.chunk = chunk;
+			slot.ready = false;
+			unsigned int version = ++slot.version;
+			mChunkSlots[chunk] = slotIndex;
+
+			if (mChunkShader) {
+				generateChunkGpu(chunk, slot);
+				dispatched = true;
+				continue;
+			}
+
+			mJobs.push([this, chunk, slotIndex, version]() {
+				CompletedChunk result;
+				result.slot = slotIndex;
+				result.version = version;
+				generateChunk(chunk, result.vertices);
+				std::lock_guard<std::mutex> lock(mCompletedMutex);
+				mCompleted.push_back(std::move(result));
+			});
+		}
+		if (dispatched) {
+			glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+		}
+
+		//LOD SELECTION
+		std::vector<int> drawn;
+		std::vector<float> distances;
+		mResidentChunkCount = 0;
+		mPendingChunkCount = 0;
+		for (const std::pair<float, int>& candidate : candidates)
+		{
+			int slot = mChunkSlots[candidate.second];
+			if (slot < 0) {
+				continue;
+			}
+			mResidentChunkCount++;
+			if (mSlots[slot].ready) {
+				drawn.push_back(candidate.second);
+				distances.push_back(candidate.first);
+			}
+			else {
+				mPendingChunkCount++;
+			}
+		}
+
+		auto isDrawn = [this](int chunk) {
+			int slot = mChunkSlots[chunk];
+			return slot >= 0 && mSlots[slot].ready;
+		};
+
+		//Raise the LOD bias until the terrain fits the triangle budget
+		for (mLodBias = 0; mLodBias <= MAX_LOD; mLodBias++)
+		{
+			for (size_t i = 0; i < drawn.size(); i++)
+			{
+				int lod = distances[i] < mSettings.lodDistance ? 0 : (int)log2f(distances[i] / mSettings.lodDistance) + 1;
+				mChunkLods[drawn[i]] = std::min(lod + mLodBias, (int)MAX_LOD);
+			}
+
+			//Stitching only handles neighbours one LOD apart, so coarsen chunks until that holds everywhere
+			bool changed = true;
+			while (changed)
+			{
+				changed = false;
+				for (int chunk : drawn)
+				{
+					int x = chunk % mChunksPerSide, z = chunk / mChunksPerSide;
+					int neighbours[4] = {
+						x > 0 ? chunk - 1 : -1,
+						x < mChunksPerSide - 1 ? chunk + 1 : -1,
+						z > 0 ? chunk - mChunksPerSide : -1,
+						z < mChunksPerSide - 1 ? chunk + mChunksPerSide : -1
+					};
+					for (int neighbour : neighbours)
+					{
+						if (neighbour >= 0 && isDrawn(neighbour) && mChunkLods[chunk] < mChunkLods[neighbour] - 1) {
+							mChunkLods[chunk] = mChunkLods[neighbour] - 1;
+							changed = true;
+						}
+					}
+				}
+			}
+
+			mDrawnTriangleCount = 0;
+			for (int chunk : drawn) {
+				mDrawnTriangleCount += mIndexRanges[mChunkLods[chunk]][0].indexCount / 3;
+			}
+			if (mDrawnTriangleCount <= mSettings.triangleBudget) {
+				break;
+			}
+		}
+		mLodBias = std::min(mLodBias, (int)MAX_LOD);
+	}
+
+	void Terrain::draw()
+	{
+		mDrawnChunkCount = 0;
+		for (const ChunkSlot& slot : mSlots)
+		{
+			if (!slot.ready) {
+				continue;
+			}
+			int chunk = slot.chunk;
+			int lod = getChunkLod(chunk);
+			int x = chunk % mChunksPerSide, z = chunk / mChunksPerSide;
+
+			//Stitch every side whose neighbour is drawn coarser
+			int mask = 0;
+			auto neighbourLod = [this](int neighbour) {
+				int slot = mChunkSlots[neighbour];
+				return slot >= 0 && mSlots[slot].ready ? mChunkLods[neighbour] : -1;
+			};
+			if (x > 0 && neighbourLod(chunk - 1) > lod) mask |= SIDE_LEFT;
+			if (x < mChunksPerSide - 1 && neighbourLod(chunk + 1) > lod) mask |= SIDE_RIGHT;
+			if (z > 0 && neighbourLod(chunk - mChunksPerSide) > lod) mask |= SIDE_BOTTOM;
+			if (z < mChunksPerSide - 1 && neighbourLod(chunk + mChunksPerSide) > lod) mask |= SIDE_TOP;
+
+			const IndexRange& range = mIndexRanges[lod][mask];
+			glBindVertexArray(slot.vao);
+			glDrawElements(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (const void*)(range.firstIndex * sizeof(unsigned int)));
+			mDrawnChunkCount++;
+		}
+	}
+}
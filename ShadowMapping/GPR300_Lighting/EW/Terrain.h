@@ -0,0 +1,107 @@
+#pragma once
+#include "Mesh.h"
+#include "JobQueue.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <mutex>
+
+class Shader;
+
+namespace ew {
+	struct TerrainSettings {
+		float worldSize = 4096.0f;		//Width and depth in meters, 4096 x 4096 is ~16 km^2
+		float chunkSize = 128.0f;		//Must divide worldSize
+		float heightScale = 150.0f;
+		float baseHeight = -1.05f;		//Height of the flat area around the origin
+		float flatRadius = 40.0f;		//Terrain stays flat inside this, and ramps up to full height by 5x it
+		float noiseScale = 700.0f;		//Size in meters of the largest hills
+		float uvScale = 8.0f;			//Meters per texture repeat
+		float viewDistance = 1000.0f;	//Chunks further than this are unloaded
+		float lodDistance = 160.0f;		//Chunks closer than this are full detail, each LOD after doubles the distance
+		int maxResidentChunks = 256;	//Size of the GPU chunk buffer pool
+		int triangleBudget = 1000000;	//LODs get coarser until the drawn terrain fits in this
+		unsigned int seed = 1337;
+	};
+
+	/// <summary>
+	/// Chunked heightfield terrain. Chunks are generated on worker threads, uploaded into a fixed pool of
+	/// vertex buffers, and drawn with geomipmapping LODs stitched to their neighbours so there are no cracks.
+	/// Vertices are in world space and use the regular ew::Vertex layout, so it draws with any mesh shader.
+	/// </summary>
+	class Terrain {
+	public:
+		Terrain(const TerrainSettings& settings);
+		~Terrain();
+		//Finishes uploads, streams chunks in and out around the camera and picks LODs. Main thread only
+		void update(const glm::vec3& cameraPosition);
+		void draw();
+		float getHeight(float x, float z)const;
+		//Generates chunks with shaders/terrainChunk.comp straight into the slot buffers instead of on workers.
+		//Pass nullptr to go back to CPU generation. Chunks already resident are kept
+		void setGpuGenerator(Shader* chunkShader);
+		inline bool isGpuGenerated()const { return mChunkShader != nullptr; }
+
+		inline int getResidentChunkCount()const { return mResidentChunkCount; }
+		inline int getPendingChunkCount()const { return mPendingChunkCount; }
+		inline int getDrawnChunkCount()const { return mDrawnChunkCount; }
+		inline int getDrawnTriangleCount()const { return mDrawnTriangleCount; }
+		inline int getLodBias()const { return mLodBias; }
+		//GPU memory held by the chunk pool + shared index buffer, fixed at construction
+		inline size_t getGpuMemoryBytes()const { return mGpuMemoryBytes; }
+
+		//Quads per chunk side at full detail. Has to be a power of two
+		static const int CHUNK_QUADS = 64;
+		static const int CHUNK_VERTICES = CHUNK_QUADS + 1;
+		//At MAX_LOD a chunk is a single 2x2 block of quads
+		static const int MAX_LOD = 5;
+	private:
+		Terrain(const Terrain& r) = delete;
+
+		struct ChunkSlot {
+			GLuint vao = 0, vbo = 0;
+			int chunk = -1;			//Index into the chunk grid, -1 if the slot is free
+			unsigned int version = 0;	//Bumped every time the slot is reassigned, so stale uploads get dropped
+			bool ready = false;
+		};
+		struct CompletedChunk {
+			int slot;
+			unsigned int version;
+			std::vector<Vertex> vertices;
+		};
+		//Index buffer section for one LOD + stitch mask combination
+		struct IndexRange {
+			unsigned int firstIndex;
+			unsigned int indexCount;
+		};
+
+		void buildIndexBuffer();
+		void generateChunk(int chunk, std::vector<Vertex>& vertices)const;
+		void generateChunkGpu(int chunk, ChunkSlot& slot);
+		glm::vec2 getChunkOrigin(int chunk)const;
+		int getChunkLod(int chunk)const;
+
+		TerrainSettings mSettings;
+		int mChunksPerSide;
+		GLuint mEBO;
+		IndexRange mIndexRanges[MAX_LOD + 1][16];
+
+		std::vector<ChunkSlot> mSlots;
+		std::vector<int> mFreeSlots;
+		std::vector<int> mChunkSlots;	//Per chunk, slot index or -1
+		std::vector<int> mChunkLods;	//Per chunk, LOD picked this frame
+
+		std::mutex mCompletedMutex;
+		std::vector<CompletedChunk> mCompleted;
+
+		int mResidentChunkCount = 0;
+		int mPendingChunkCount = 0;
+		int mDrawnChunkCount = 0;
+		int mDrawnTriangleCount = 0;
+		int mLodBias = 0;
+		size_t mGpuMemoryBytes = 0;
+		Shader* mChunkShader = nullptr;
+
+		//Declared last so workers are joined before anything they touch is destroyed
+		JobQueue mJobs;
+	};
+}
@@ -11,7 +11,11 @@ namespace ew {
 		glm::vec3 scale = glm::vec3(1);
 
 		glm::mat4 getModelMatrix() {
-			return ew::translate(position) * ew::rotateX(rotation.x) * ew::rotateY(rotation.y) * ew::rotateZ(rotation.z) * ew::scale(scale);
+			return ew::composeTRS(position, rotation, scale);
+		}
+		//Upload next to the model matrix instead of inverting it per vertex
+		glm::mat3 getNormalMatrix() {
+			return ew::composeNormalMatrix(rotation, scale);
 		}
 		void reset() {
 			position = glm::vec3(0);
@@ -0,0 +1,223 @@
+#include "TransformStore.h"
+#include "Parallel.h"
+#include <immintrin.h>
+
+namespace ew {
+	//The batch kernel is written once against these, for whichever SIMD width the build targets
+#if defined(__AVX2__)
+	typedef __m256 Lanes;
+	typedef __m256i IntLanes;
+	const int LANES = 8;
+	static inline Lanes lanesLoad(const float* p) { return _mm256_loadu_ps(p); }
+	static inline void lanesStore(float* p, Lanes a) { _mm256_storeu_ps(p, a); }
+	static inline Lanes lanesSet(float a) { return _mm256_set1_ps(a); }
+	static inline Lanes lanesAdd(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+	static inline Lanes lanesSub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+	static inline Lanes lanesMul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+	static inline Lanes lanesDiv(Lanes a, Lanes b) { return _mm256_div_ps(a, b); }
+	static inline Lanes lanesXor(Lanes a, Lanes b) { return _mm256_xor_ps(a, b); }
+	static inline Lanes lanesSelect(Lanes mask, Lanes a, Lanes b) { return _mm256_blendv_ps(b, a, mask); }
+	static inline IntLanes lanesRoundToInt(Lanes a) { return _mm256_cvtps_epi32(a); }
+	static inline Lanes lanesToFloat(IntLanes a) { return _mm256_cvtepi32_ps(a); }
+	//Bit of each lane moved up to the sign bit, as a float mask
+	static inline Lanes lanesBitToSign(IntLanes a, int bit) { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(a, _mm256_set1_epi32(1 << bit)), 31 - bit)); }
+#else
+	typedef __m128 Lanes;
+	typedef __m128i IntLanes;
+	const int LANES = 4;
+	static inline Lanes lanesLoad(const float* p) { return _mm_loadu_ps(p); }
+	static inline void lanesStore(float* p, Lanes a) { _mm_storeu_ps(p, a); }
+	static inline Lanes lanesSet(float a) { return _mm_set1_ps(a); }
+	static inline Lanes lanesAdd(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+	static inline Lanes lanesSub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+	static inline Lanes lanesMul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	static inline Lanes lanesDiv(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+	static inline Lanes lanesXor(Lanes a, Lanes b) { return _mm_xor_ps(a, b); }
+	//SSE2 has no blendv, but the masks here are only ever read through the sign bit, so spread it first
+	static inline Lanes lanesSelect(Lanes mask, Lanes a, Lanes b) {
+		Lanes m = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(mask), 31));
+		return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+	}
+	static inline IntLanes lanesRoundToInt(Lanes a) { return _mm_cvtps_epi32(a); }
+	static inline Lanes lanesToFloat(IntLanes a) { return _mm_cvtepi32_ps(a); }
+	static inline Lanes lanesBitToSign(IntLanes a, int bit) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(a, _mm_set1_epi32(1 << bit)), 31 - bit)); }
+#endif
+
+	//sin and cos together. Reduces to [-pi/4, pi/4] around the nearest multiple of pi/2 and uses the cephes
+	//polynomials from there. Within ~1e-7 of sinf/cosf for angles up to a few thousand radians
+	static inline void lanesSinCos(Lanes x, Lanes& outSin, Lanes& outCos)
+	{
+		IntLanes quadrant = lanesRoundToInt(lanesMul(x, lanesSet(0.636619772f)));
+		Lanes q = lanesToFloat(quadrant);
+		//pi/2 split in three so the reduction stays exact
+		Lanes r = lanesSub(x, lanesMul(q, lanesSet(1.5703125f)));
+		r = lanesSub(r, lanesMul(q, lanesSet(4.837512969970703125e-4f)));
+		r = lanesSub(r, lanesMul(q, lanesSet(7.54978995489188216e-8f)));
+		Lanes r2 = lanesMul(r, r);
+
+		Lanes s = lanesAdd(lanesMul(lanesSet(-1.9515295891e-4f), r2), lanesSet(8.3321608736e-3f));
+		s = lanesAdd(lanesMul(s, r2), lanesSet(-1.6666654611e-1f));
+		s = lanesAdd(lanesMul(lanesMul(s, r2), r), r);
+
+		Lanes c = lanesAdd(lanesMul(lanesSet(2.443315711809948e-5f), r2), lanesSet(-1.388731625493765e-3f));
+		c = lanesAdd(lanesMul(c, r2), lanesSet(4.166664568298827e-2f));
+		c = lanesAdd(lanesMul(lanesMul(c, r2), r2), lanesSub(lanesSet(1.0f), lanesMul(r2, lanesSet(0.5f))));
+
+		//Odd quadrants swap sin and cos, sin flips in quadrants 2 and 3, cos in 1 and 2
+		Lanes swap = lanesBitToSign(quadrant, 0);
+		Lanes sinResult = lanesSelect(swap, c, s);
+		Lanes cosResult = lanesSelect(swap, s, c);
+		outSin = lanesXor(sinResult, lanesBitToSign(quadrant, 1));
+		outCos = lanesXor(cosResult, lanesXor(swap, lanesBitToSign(quadrant, 1)));
+	}
+
+	int TransformStore::create(const Transform& transform)
+	{
+		int id = mCount++;
+		int paddedCount = (int)mDirty.size() * 64;
+		if (mCount > paddedCount) {
+			paddedCount += 64;
+			mPositionX.resize(paddedCount, 0.0f); mPositionY.resize(paddedCount, 0.0f); mPositionZ.resize(paddedCount, 0.0f);
+			mRotationX.resize(paddedCount, 0.0f); mRotationY.resize(paddedCount, 0.0f); mRotationZ.resize(paddedCount, 0.0f);
+			mScaleX.resize(paddedCount, 1.0f); mScaleY.resize(paddedCount, 1.0f); mScaleZ.resize(paddedCount, 1.0f);
+			mDirty.push_back(0);
+		}
+		mWorldMatrices.push_back(glm::mat4(1));
+		mNormalMatrices.push_back(glm::mat3(1));
+		set(id, transform);
+		return id;
+	}
+
+	void TransformStore::clear()
+	{
+		mCount = 0;
+		mPositionX.clear(); mPositionY.clear(); mPositionZ.clear();
+		mRotationX.clear(); mRotationY.clear(); mRotationZ.clear();
+		mScaleX.clear(); mScaleY.clear(); mScaleZ.clear();
+		mDirty.clear();
+		mWorldMatrices.clear();
+		mNormalMatrices.clear();
+	}
+
+	void TransformStore::set(int id, const Transform& transform)
+	{
+		setPosition(id, transform.position);
+		setRotation(id, transform.rotation);
+		setScale(id, transform.scale);
+	}
+
+	void TransformStore::setPosition(int id, const glm::vec3& position)
+	{
+		mPositionX[id] = position.x; mPositionY[id] = position.y; mPositionZ[id] = position.z;
+		markDirty(id);
+	}
+
+	void TransformStore::setRotation(int id, const glm::vec3& rotation)
+	{
+		mRotationX[id] = rotation.x; mRotationY[id] = rotation.y; mRotationZ[id] = rotation.z;
+		markDirty(id);
+	}
+
+	void TransformStore::setScale(int id, const glm::vec3& scale)
+	{
+		mScaleX[id] = scale.x; mScaleY[id] = scale.y; mScaleZ[id] = scale.z;
+		markDirty(id);
+	}
+
+	glm::vec3 TransformStore::getPosition(int id)const
+	{
+		return glm::vec3(mPositionX[id], mPositionY[id], mPositionZ[id]);
+	}
+
+	glm::vec3 TransformStore::getRotation(int id)const
+	{
+		return glm::vec3(mRotationX[id], mRotationY[id], mRotationZ[id]);
+	}
+
+	glm::vec3 TransformStore::getScale(int id)const
+	{
+		return glm::vec3(mScaleX[id], mScaleY[id], mScaleZ[id]);
+	}
+
+	void TransformStore::update(bool parallel)
+	{
+		int numWords = (int)mDirty.size();
+		mLastUpdatedCount = 0;
+		for (uint64_t word : mDirty) {
+			for (; word; word &= word - 1) {
+				mLastUpdatedCount++;
+			}
+		}
+		if (mLastUpdatedCount == 0) {
+			return;
+		}
+		//A word is 64 transforms, a few hundred ns of work, so threads only pay off for large stores
+		parallelFor(numWords, parallel ? 256 : numWords, [this](int begin, int end) {
+			updateWords(begin, end);
+		});
+	}
+
+	//Same math as composeTRS and composeNormalMatrix, one entity per lane
+	void TransformStore::updateWords(int firstWord, int endWord)
+	{
+		const uint64_t blockMask = (1ull << LANES) - 1;
+		for (int word = firstWord; word < endWord; word++)
+		{
+			uint64_t dirty = mDirty[word];
+			if (!dirty) {
+				continue;
+			}
+			mDirty[word] = 0;
+			for (int offset = 0; offset < 64; offset += LANES)
+			{
+				uint64_t blockDirty = (dirty >> offset) & blockMask;
+				if (!blockDirty) {
+					continue;
+				}
+				int first = word * 64 + offset;
+				Lanes sx, cx, sy, cy, sz, cz;
+				lanesSinCos(lanesLoad(&mRotationX[first]), sx, cx);
+				lanesSinCos(lanesLoad(&mRotationY[first]), sy, cy);
+				lanesSinCos(lanesLoad(&mRotationZ[first]), sz, cz);
+				Lanes sxsy = lanesMul(sx, sy);
+				Lanes cxsy = lanesMul(cx, sy);
+
+				//Rotation columns. The world matrix scales them, the normal matrix divides by the scale instead
+				Lanes r[9];
+				r[0] = lanesMul(cy, cz);
+				r[1] = lanesSub(lanesMul(cx, sz), lanesMul(sxsy, cz));
+				r[2] = lanesAdd(lanesMul(sx, sz), lanesMul(cxsy, cz));
+				r[3] = lanesMul(lanesSub(lanesSet(0.0f), cy), sz);
+				r[4] = lanesAdd(lanesMul(cx, cz), lanesMul(sxsy, sz));
+				r[5] = lanesSub(lanesMul(sx, cz), lanesMul(cxsy, sz));
+				r[6] = lanesSub(lanesSet(0.0f), sy);
+				r[7] = lanesMul(lanesSub(lanesSet(0.0f), sx), cy);
+				r[8] = lanesMul(cx, cy);
+				Lanes s[3] = { lanesLoad(&mScaleX[first]), lanesLoad(&mScaleY[first]), lanesLoad(&mScaleZ[first]) };
+				Lanes one = lanesSet(1.0f);
+				Lanes inverseScale[3] = { lanesDiv(one, s[0]), lanesDiv(one, s[1]), lanesDiv(one, s[2]) };
+				float worldColumns[9][LANES];
+				float normalColumns[9][LANES];
+				for (int i = 0; i < 9; i++) {
+					lanesStore(worldColumns[i], lanesMul(r[i], s[i / 3]));
+					lanesStore(normalColumns[i], lanesMul(r[i], inverseScale[i / 3]));
+				}
+
+				//Transpose out. Clean lanes are rewritten with the same value, which is cheaper than skipping them
+				int numLanes = std::min(LANES, mCount - first);
+				for (int lane = 0; lane < numLanes; lane++)
+				{
+					float* m = &mWorldMatrices[first + lane][0][0];
+					m[0] = worldColumns[0][lane]; m[1] = worldColumns[1][lane]; m[2] = worldColumns[2][lane]; m[3] = 0.0f;
+					m[4] = worldColumns[3][lane]; m[5] = worldColumns[4][lane]; m[6] = worldColumns[5][lane]; m[7] = 0.0f;
+					m[8] = worldColumns[6][lane]; m[9] = worldColumns[7][lane]; m[10] = worldColumns[8][lane]; m[11] = 0.0f;
+					m[12] = mPositionX[first + lane]; m[13] = mPositionY[first + lane]; m[14] = mPositionZ[first + lane]; m[15] = 1.0f;
+					float* n = &mNormalMatrices[first + lane][0][0];
+					for (int i = 0; i < 9; i++) {
+						n[i] = normalColumns[i][lane];
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Transform.h"
+#include <vector>
+#include <stdint.h>
+
+namespace ew {
+	/// <summary>
+	/// Transforms stored as structure of arrays, with a dirty bit per entity. update() recomputes the world
+	/// matrices of everything that changed in SIMD batches (8 wide with AVX2, 4 wide otherwise), optionally across
+	/// worker threads, and caches them so every pass in the frame reads the same matrix without rebuilding it.
+	/// Matrices match Transform::getModelMatrix and Transform::getNormalMatrix
+	/// </summary>
+	class TransformStore {
+	public:
+		//Returns the id used by everything else. Ids are dense and stay valid until clear()
+		int create(const Transform& transform = Transform());
+		void clear();
+
+		void set(int id, const Transform& transform);
+		void setPosition(int id, const glm::vec3& position);
+		void setRotation(int id, const glm::vec3& rotation);
+		void setScale(int id, const glm::vec3& scale);
+		glm::vec3 getPosition(int id)const;
+		glm::vec3 getRotation(int id)const;
+		glm::vec3 getScale(int id)const;
+
+		//Rebuilds the world matrix of every dirty entity
+		void update(bool parallel = true);
+		//After any set* on the entity, this is stale until the next update()
+		inline const glm::mat4& getWorldMatrix(int id)const { return mWorldMatrices[id]; }
+		//Inverse transpose of the world matrix's upper 3x3, built in the same batch
+		inline const glm::mat3& getNormalMatrix(int id)const { return mNormalMatrices[id]; }
+		inline int getCount()const { return mCount; }
+		inline int getLastUpdatedCount()const { return mLastUpdatedCount; }
+	private:
+		inline void markDirty(int id) { mDirty[id >> 6] |= 1ull << (id & 63); }
+		void updateWords(int firstWord, int endWord);
+
+		int mCount = 0;
+		int mLastUpdatedCount = 0;
+		//Padded to a whole number of 64 entity dirty words, so batches never read past the end
+		std::vector<float> mPositionX, mPositionY, mPositionZ;
+		std::vector<float> mRotationX, mRotationY, mRotationZ;
+		std::vector<float> mScaleX, mScaleY, mScaleZ;
+		std::vector<uint64_t> mDirty;
+		std::vector<glm::mat4> mWorldMatrices;
+		std::vector<glm::mat3> mNormalMatrices;
+	};
+}
@@ -7,6 +7,10 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <stdio.h>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+#include <string>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -17,10 +21,27 @@
 
 #include "EW/Shader.h"
 #include "EW/EwMath.h"
+#include "EW/SimdMath.h"
 #include "EW/Camera.h"
 #include "EW/Mesh.h"
 #include "EW/Transform.h"
+#include "EW/TransformStore.h"
+#include "EW/SceneGraph.h"
 #include "EW/ShapeGen.h"
+#include "EW/StaticBatch.h"
+#include "EW/Terrain.h"
+#include "EW/MeshCache.h"
+#include "EW/ImpostorBatch.h"
+#include "EW/GpuShapeGen.h"
+#include "EW/Animation.h"
+#include "EW/Skinning.h"
+#include "EW/Parallel.h"
+#include "EW/Culling.h"
+#include "EW/Bvh.h"
+#include "EW/OcclusionCulling.h"
+#include "EW/OcclusionQueries.h"
+#include "EW/LightLists.h"
+#include "EW/RenderQueue.h"
 
 void processInput(GLFWwindow* window);
 void resizeFrameBufferCallback(GLFWwindow* window, int width, int height);
@@ -59,6 +80,74 @@ glm::vec3 lightPosition = glm::vec3(0.0f, -1.0f, 0.0f);
 
 bool wireFrame = false;
 
+//Left click with the cursor unlocked picks the static object under it
+bool pickRequested = false;
+double pickX, pickY;
+bool showLightGizmo = false;
+
+//Fixed primitives are generated at compile time and uploaded straight from read only memory
+constexpr ew::StaticMeshData<4, 6> QUAD_MESH_DATA = ew::makeQuad(2.0f, 2.0f);
+constexpr ew::StaticMeshData<24, 36> CUBE_MESH_DATA = ew::makeCube(1.0f, 1.0f, 1.0f);
+constexpr ew::StaticMeshData<4, 6> PLANE_MESH_DATA = ew::makePlane(1.0f, 1.0f);
+
+//How the sphere and cylinder are drawn: regular meshes, coarse control meshes refined by
+//tessellation shaders, or ray cast impostors
+const int CURVED_SHAPES_MESH = 0;
+const int CURVED_SHAPES_TESSELLATED = 1;
+const int CURVED_SHAPES_IMPOSTOR = 2;
+int curvedShapeMode = CURVED_SHAPES_MESH;
+float tessTargetEdgePixels = 12.0f;
+float tessMaxLevel = 64.0f;
+
+//Extra impostor spheres on a grid above the scene, for benchmarking
+int impostorSphereCount = 0;
+//Impostors are frustum culled by a compute pass and drawn indirectly in the lit pass. The shadow pass still draws them all
+bool gpuImpostorCulling = true;
+const int MAX_IMPOSTOR_SPHERES = 100000;
+
+//Static props are scattered around the scene on a grid, for stress testing batching
+bool useStaticBatching = true;
+int staticPropCount = 0;
+const int MAX_STATIC_PROPS = 10000;
+const float STATIC_PROP_SPACING = 1.5f;
+//Static objects outside the camera frustum are skipped in the lit pass
+bool frustumCulling = true;
+//Static objects only go into the shadow map if they can shadow something the camera sees
+bool shadowCasterCulling = true;
+//Static objects hidden behind the nearest occluders are skipped too, tested against a CPU rasterized depth buffer
+bool occlusionCulling = false;
+const int MAX_OCCLUDERS = 32;
+//Big box behind the scene, in front of the back of the prop grid, to have something worth occluding
+bool showOccluderWall = false;
+//Heavy objects are drawn last, each only if a GPU query on its bounding box says some of it is in front of the depth buffer
+bool gpuOcclusionQueries = false;
+
+//Streamed heightfield around the scene, flattened under it
+bool showTerrain = false;
+bool gpuTerrain = false;
+
+//Shape generated by a compute shader, next to the scene. 0 = sphere, 1 = cylinder, 2 = plane
+bool showGpuShape = false;
+int gpuShapeType = 0;
+int gpuShapeSegments = 64;
+
+//Swaying skinned tubes on a grid behind the scene, skinned once per frame by a compute shader
+bool showCharacters = false;
+bool dualQuaternionSkinning = false;
+int characterCount = 100;
+const int MAX_CHARACTERS = 1000;
+const int CHARACTER_JOINTS = 8;
+const float CHARACTER_SPACING = 1.0f;
+
+//Point and spot lights scattered over the prop grid. Static objects are each lit by the few that affect them most
+int localLightCount = 0;
+float localLightRange = 3.0f;
+const float LOCAL_LIGHT_AREA = 30.0f;
+
+//Render queue packets are sorted front to back over this distance, anything farther sorts as farthest
+const float RENDER_QUEUE_DEPTH_RANGE = 200.0f;
+enum RenderPass { RENDER_PASS_LIT, RENDER_PASS_UNLIT };
+
 struct DirectionalLight
 {
 	glm::vec3 color = glm::vec3(1);
@@ -83,6 +172,14 @@ struct SpotLight
 	float minAngle = 80;
 	float maxAngle = 140;
 };
+struct StaticObject
+{
+	ew::MeshDataView meshData;
+	ew::Mesh* mesh;
+	int transform;	//Id in the scene's TransformStore
+	bool castsShadow = true;
+	bool occludes = false;	//Can go into the occlusion buffer
+};
 struct Material
 {
 	glm::vec3 color = glm::vec3(1, 1, 1);
@@ -93,6 +190,10 @@ struct Material
 };
 
 int main() {
+	if (!ew::isBuildSimdSupported()) {
+		printf("this build needs a CPU with AVX2 and FMA");
+		return 1;
+	}
 	if (!glfwInit()) {
 		printf("glfw failed to init");
 		return 1;
@@ -126,6 +227,9 @@ int main() {
 
 	//Used to draw shapes. This is the shader you will be completing.
 	Shader litShader("shaders/defaultLit.vert", "shaders/defaultLit.frag");
+	//Set per draw, so looked up once
+	const GLint objectLightsLocation = litShader.getUniformLocation("_ObjectLights");
+	const GLint numObjectLightsLocation = litShader.getUniformLocation("_NumObjectLights");
 
 	//Used to draw light sphere
 	Shader unlitShader("shaders/defaultLit.vert", "shaders/unlit.frag");
@@ -133,22 +237,43 @@ int main() {
 
 	Shader depthShader("shaders/depth.vert", "shaders/depth.frag");
 
-	ew::MeshData quadMeshData;
-	ew::createQuad(2, 2, quadMeshData);
-	ew::Mesh quadMesh(&quadMeshData);
-	ew::MeshData cubeMeshData;
-	ew::createCube(1.0f, 1.0f, 1.0f, cubeMeshData);
-	ew::MeshData sphereMeshData;
-	ew::createSphere(0.5f, 64, sphereMeshData);
-	ew::MeshData cylinderMeshData;
-	ew::createCylinder(1.0f, 0.5f, 64, cylinderMeshData);
-	ew::MeshData planeMeshData;
-	ew::createPlane(1.0f, 1.0f, planeMeshData);
-
-	ew::Mesh cubeMesh(&cubeMeshData);
-	ew::Mesh sphereMesh(&sphereMeshData);
-	ew::Mesh planeMesh(&planeMeshData);
-	ew::Mesh cylinderMesh(&cylinderMeshData);
+	//Adaptive sphere/cylinder, same fragment shaders as the regular passes
+	Shader tessLitShader("shaders/tess.vert", "shaders/tess.tesc", "shaders/tess.tese", "shaders/defaultLit.frag");
+	Shader tessDepthShader("shaders/tess.vert", "shaders/tess.tesc", "shaders/tess.tese", "shaders/depth.frag");
+
+	//Ray cast sphere/cylinder impostors
+	Shader impostorLitShader("shaders/impostor.vert", "shaders/impostor.frag");
+	Shader impostorDepthShader("shaders/impostor.vert", "shaders/impostorDepth.frag");
+
+	//Compute shaders that generate meshes and terrain chunks straight into GPU buffers
+	Shader shapeGenShader("shaders/shapegen.comp");
+	Shader terrainChunkShader("shaders/terrainChunk.comp");
+	Shader skinningShader("shaders/skinning.comp");
+	Shader impostorCullShader("shaders/impostorCull.comp");
+
+	//Every mesh comes from the cache, so asking for the same shape twice shares one GPU mesh
+	ew::MeshCache meshCache;
+	std::shared_ptr<ew::Mesh> quadMesh = meshCache.getMesh(QUAD_MESH_DATA);
+	std::shared_ptr<const ew::MeshData> sphereMeshData = meshCache.getMeshData(ew::ShapeDesc::sphere(0.5f, 64));
+	std::shared_ptr<const ew::MeshData> cylinderMeshData = meshCache.getMeshData(ew::ShapeDesc::cylinder(1.0f, 0.5f, 64));
+
+	std::shared_ptr<ew::Mesh> cubeMesh = meshCache.getMesh(CUBE_MESH_DATA);
+	std::shared_ptr<ew::Mesh> sphereMesh = meshCache.getMesh(ew::ShapeDesc::sphere(0.5f, 64));
+	std::shared_ptr<ew::Mesh> planeMesh = meshCache.getMesh(PLANE_MESH_DATA);
+	std::shared_ptr<ew::Mesh> cylinderMesh = meshCache.getMesh(ew::ShapeDesc::cylinder(1.0f, 0.5f, 64));
+
+	//Low poly versions for props
+	std::shared_ptr<const ew::MeshData> propSphereMeshData = meshCache.getMeshData(ew::ShapeDesc::sphere(0.5f, 8));
+	std::shared_ptr<const ew::MeshData> propCylinderMeshData = meshCache.getMeshData(ew::ShapeDesc::cylinder(1.0f, 0.5f, 8));
+	std::shared_ptr<ew::Mesh> propSphereMesh = meshCache.getMesh(ew::ShapeDesc::sphere(0.5f, 8));
+	std::shared_ptr<ew::Mesh> propCylinderMesh = meshCache.getMesh(ew::ShapeDesc::cylinder(1.0f, 0.5f, 8));
+
+	ew::MeshData sphereControlMeshData;
+	ew::createSphereControlMesh(0.5f, sphereControlMeshData);
+	ew::Mesh sphereControlMesh(&sphereControlMeshData);
+	ew::MeshData cylinderControlMeshData;
+	ew::createCylinderControlMesh(1.0f, 0.5f, 8, cylinderControlMeshData);
+	ew::Mesh cylinderControlMesh(&cylinderControlMeshData);
 
 	//Enable back face culling
 	glEnable(GL_CULL_FACE);
@@ -180,9 +305,102 @@ int main() {
 	pointLight1Transform.scale = glm::vec3(0.5f);
 	pointLight2Transform.scale = glm::vec3(0.5f);
 
+	//Nothing in the scene moves, so it can all be baked into one static batch
+	std::vector<StaticObject> staticObjects;
+	ew::TransformStore staticTransforms;
+
+	//GPU time of the lit pass. Two queries so last frame's result is read while this frame's is in flight
+	GLuint litPassQueries[2];
+	glGenQueries(2, litPassQueries);
+	int litPassQueryFrame = 0;
+	float litPassMs = 0.0f;
+	ew::StaticBatch* staticBatch = nullptr;
+	ew::CullingBounds staticBounds;
+	std::vector<int> visibleStatic;
+	std::vector<int> visibleCasters;
+	std::vector<glm::vec3> staticBoundsMin, staticBoundsMax;
+	ew::Bvh staticBvh;
+	ew::OcclusionCuller occlusionCuller;
+	std::vector<std::pair<float, int>> occluderCandidates;
+	int occludedCount = 0;
+	float occlusionMs = 0.0f;
+	ew::OcclusionQueries occlusionQueries;
+	std::vector<int> litStatic;
+	std::vector<int> queriedStatic;
+	int pickedObject = -1;
+	float pickMs = 0.0f;
+	float cullMs = 0.0f;
+	int builtPropCount = -1;
+	bool builtOccluderWall = false;
+	int builtCurvedShapeMode = -1;
+	int builtImpostorSphereCount = -1;
+	ew::ImpostorBatch sphereImpostors;
+	ew::ImpostorBatch cylinderImpostors;
+
+	ew::TerrainSettings terrainSettings;
+	terrainSettings.baseHeight = planeTransform.position.y - 0.05f;
+	//Created the first time it's shown. Its buffers and worker threads are only paid for when it's used
+	ew::Terrain* terrain = nullptr;
+
+	ew::GpuMesh gpuShapeMesh(&shapeGenShader);
+	ew::Transform gpuShapeTransform;
+	gpuShapeTransform.position = glm::vec3(0.0f, 0.0f, -2.0f);
+	int builtGpuShapeType = -1;
+	int builtGpuShapeSegments = -1;
+	float gpuShapeDifference = 0.0f;
+	bool gpuShapeCompared = false;
+
+	//Characters: a tube rigged to a chain of joints, every joint swaying on the same clip a little out of phase
+	ew::MeshData characterMeshData;
+	std::vector<ew::SkinWeights> characterSkin;
+	ew::createSkinnedTube(2.0f, 0.15f, 16, 24, CHARACTER_JOINTS, characterMeshData, characterSkin);
+	ew::Skeleton characterSkeleton;
+	ew::AnimationClip swayClip;
+	for (int i = 0; i < CHARACTER_JOINTS; i++) {
+		int joint = characterSkeleton.addJoint(i - 1, glm::vec3(0.0f, i == 0 ? 0.0f : 2.0f / CHARACTER_JOINTS, 0.0f));
+		int track = swayClip.addTrack(ew::AnimationChannel::Rotation, joint);
+		for (int key = 0; key <= 8; key++) {
+			float t = key / 8.0f;
+			float angle = 0.2f * sin(t * glm::two_pi<float>() - i * 0.6f);
+			swayClip.addKey(track, t * 2.0f, glm::angleAxis(angle, glm::vec3(0, 0, 1)) * glm::angleAxis(angle * 0.5f, glm::vec3(1, 0, 0)));
+		}
+	}
+	ew::SkinnedMeshBatch characters(characterMeshData, characterSkin, CHARACTER_JOINTS, MAX_CHARACTERS);
+	std::vector<ew::AnimationPlayer> characterPlayers;
+	for (int i = 0; i < MAX_CHARACTERS; i++) {
+		characterPlayers.push_back(ew::AnimationPlayer(&swayClip));
+		characterPlayers[i].setTime(i * 0.37f);
+		characterPlayers[i].setSpeed(0.8f + (i % 5) * 0.1f);
+	}
+	std::vector<glm::mat4> characterPalettes;
+	GLuint skinningQueries[2];
+	glGenQueries(2, skinningQueries);
+	int skinningQueryFrame = 0;
+	float skinningMs = 0.0f;
+	float characterPaletteMs = 0.0f;
+
+	ew::LightLists lightLists;
+	int builtLocalLightCount = -1;
+	float builtLocalLightRange = 0.0f;
+	float lightListMs = 0.0f;
+
+	ew::RenderQueue renderQueue;
+	float renderQueueSortMs = 0.0f;
+
 	Material mat;
 	mat.color = glm::vec3(1, 0, 0);
 	DirectionalLight directionLight;
+
+	//Light gizmo: a bulb and an arrow parented to a node that follows the light
+	ew::SceneGraph sceneGraph;
+	int lightNode = sceneGraph.createNode();
+	int lightBulbNode = sceneGraph.createNode(lightNode);
+	sceneGraph.setLocalScale(lightBulbNode, glm::vec3(0.3f));
+	int lightArrowNode = sceneGraph.createNode(lightNode);
+	//Cylinder runs along Y, turn it to point down the node's -Z
+	sceneGraph.setLocalRotation(lightArrowNode, glm::angleAxis(-glm::half_pi<float>(), glm::vec3(1, 0, 0)));
+	sceneGraph.setLocalPosition(lightArrowNode, glm::vec3(0.0f, 0.0f, -0.5f));
+	sceneGraph.setLocalScale(lightArrowNode, glm::vec3(0.06f, 0.6f, 0.06f));
 	
 
 	GLuint textureRock;
@@ -225,6 +443,100 @@ int main() {
 
 	while (!glfwWindowShouldClose(window)) {
 		processInput(window);
+
+		if (builtPropCount != staticPropCount || builtCurvedShapeMode != curvedShapeMode || builtOccluderWall != showOccluderWall) {
+			staticObjects.clear();
+			staticTransforms.clear();
+			staticObjects.push_back({ CUBE_MESH_DATA, cubeMesh.get(), staticTransforms.create(cubeTransform), true, true });
+			if (curvedShapeMode == CURVED_SHAPES_MESH) {
+				staticObjects.push_back({ *sphereMeshData, sphereMesh.get(), staticTransforms.create(sphereTransform) });
+				staticObjects.push_back({ *cylinderMeshData, cylinderMesh.get(), staticTransforms.create(cylinderTransform) });
+			}
+			//The ground only receives
+			staticObjects.push_back({ PLANE_MESH_DATA, planeMesh.get(), staticTransforms.create(planeTransform), false });
+			if (showOccluderWall) {
+				ew::Transform wallTransform;
+				wallTransform.position = glm::vec3(0.0f, 1.0f, -3.0f);
+				wallTransform.scale = glm::vec3(20.0f, 4.0f, 0.5f);
+				staticObjects.push_back({ CUBE_MESH_DATA, cubeMesh.get(), staticTransforms.create(wallTransform), true, true });
+			}
+
+			int propsPerRow = (int)ceil(sqrt((float)staticPropCount));
+			float propOffset = (propsPerRow - 1) * STATIC_PROP_SPACING * 0.5f;
+			for (int i = 0; i < staticPropCount; i++) {
+				ew::Transform propTransform;
+				propTransform.position = glm::vec3((i % propsPerRow) * STATIC_PROP_SPACING - propOffset, -0.75f, (i / propsPerRow) * STATIC_PROP_SPACING - propOffset);
+				propTransform.rotation.y = (float)i;
+				propTransform.scale = glm::vec3(0.5f);
+				StaticObject prop = { CUBE_MESH_DATA, cubeMesh.get(), staticTransforms.create(propTransform), true, true };
+				//Only the cubes are worth rasterizing as occluders
+				switch (i % 3) {
+				case 1: prop.meshData = *propSphereMeshData; prop.mesh = propSphereMesh.get(); prop.occludes = false; break;
+				case 2: prop.meshData = *propCylinderMeshData; prop.mesh = propCylinderMesh.get(); prop.occludes = false; break;
+				}
+				staticObjects.push_back(prop);
+			}
+			staticTransforms.update();
+
+			ew::StaticBatchBuilder batchBuilder;
+			for (StaticObject& staticObject : staticObjects) {
+				batchBuilder.add(staticObject.meshData, staticTransforms.getWorldMatrix(staticObject.transform));
+			}
+			delete staticBatch;
+			staticBatch = new ew::StaticBatch(batchBuilder);
+			//Batch ranges are in staticObjects order and already have world space bounds
+			staticBounds.clear();
+			staticBoundsMin.clear();
+			staticBoundsMax.clear();
+			for (const ew::BatchRange& range : staticBatch->getRanges()) {
+				staticBounds.addBox(range.boundsMin, range.boundsMax);
+				staticBoundsMin.push_back(range.boundsMin);
+				staticBoundsMax.push_back(range.boundsMax);
+			}
+			staticBvh.build(staticBoundsMin.data(), staticBoundsMax.data(), (int)staticBoundsMin.size());
+			pickedObject = -1;
+			builtPropCount = staticPropCount;
+			builtOccluderWall = showOccluderWall;
+		}
+		if (builtImpostorSphereCount != impostorSphereCount || builtCurvedShapeMode != curvedShapeMode) {
+			std::vector<glm::mat4> sphereModels;
+			std::vector<glm::mat4> cylinderModels;
+			if (curvedShapeMode == CURVED_SHAPES_IMPOSTOR) {
+				sphereModels.push_back(sphereTransform.getModelMatrix());
+				cylinderModels.push_back(cylinderTransform.getModelMatrix());
+			}
+			int spheresPerRow = (int)ceil(sqrt((float)impostorSphereCount));
+			float sphereOffset = (spheresPerRow - 1) * 0.5f;
+			for (int i = 0; i < impostorSphereCount; i++) {
+				glm::vec3 position = glm::vec3((i % spheresPerRow) - sphereOffset, 3.0f, (i / spheresPerRow) - sphereOffset);
+				sphereModels.push_back(glm::scale(glm::translate(glm::mat4(1), position), glm::vec3(0.8f)));
+			}
+			sphereImpostors.setInstances(sphereModels);
+			cylinderImpostors.setInstances(cylinderModels);
+			builtImpostorSphereCount = impostorSphereCount;
+		}
+		builtCurvedShapeMode = curvedShapeMode;
+		int drawCount = 0;
+		if (showTerrain) {
+			if (!terrain) {
+				terrain = new ew::Terrain(terrainSettings);
+			}
+			if (gpuTerrain != terrain->isGpuGenerated()) {
+				terrain->setGpuGenerator(gpuTerrain ? &terrainChunkShader : nullptr);
+			}
+			terrain->update(camera.getPosition());
+		}
+		if (showGpuShape && (builtGpuShapeType != gpuShapeType || builtGpuShapeSegments != gpuShapeSegments)) {
+			switch (gpuShapeType)
+			{
+			case 0: gpuShapeMesh.generateSphere(0.5f, gpuShapeSegments); break;
+			case 1: gpuShapeMesh.generateCylinder(1.0f, 0.5f, gpuShapeSegments); break;
+			case 2: gpuShapeMesh.generatePlane(1.0f, 1.0f); break;
+			}
+			builtGpuShapeType = gpuShapeType;
+			builtGpuShapeSegments = gpuShapeSegments;
+			gpuShapeCompared = false;
+		}
 		glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
 		glClearColor(bgColor.r, bgColor.g, bgColor.b, 1.0f);
@@ -246,21 +558,257 @@ int main() {
 		float nearPlane = 0.1f, farPlane = 100.5f;
 		glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, nearPlane, farPlane);
 		glm::mat4 lightView = glm::lookAt(lightPosition, glm::vec3(0), glm::vec3(0.0f, 1.0f, 0.0f));
-		glm::mat4 lightMatrix = lightProjection * lightView;
+		glm::mat4 lightMatrix = ew::mulMat4(lightProjection, lightView);
+		glm::mat4 inverseLightMatrix = glm::inverse(lightMatrix);
+		const glm::mat4& cameraViewProjection = camera.getViewProjectionMatrix();
+
+		if (pickRequested) {
+			//Ray from the cursor's point on the near plane to the far plane, so the hit distance is 0 to 1
+			double pickStart = glfwGetTime();
+			glm::vec2 ndc = glm::vec2(2.0f * (float)pickX / SCREEN_WIDTH - 1.0f, 1.0f - 2.0f * (float)pickY / SCREEN_HEIGHT);
+			glm::vec4 rayStart = camera.getInverseViewProjectionMatrix() * glm::vec4(ndc, -1.0f, 1.0f);
+			glm::vec4 rayEnd = camera.getInverseViewProjectionMatrix() * glm::vec4(ndc, 1.0f, 1.0f);
+			glm::vec3 origin = glm::vec3(rayStart) / rayStart.w;
+			float hitDistance;
+			pickedObject = staticBvh.raycast(origin, glm::vec3(rayEnd) / rayEnd.w - origin, 1.0f, hitDistance);
+			pickMs = (float)((glfwGetTime() - pickStart) * 1000.0);
+			pickRequested = false;
+		}
+
+		double cullStart = glfwGetTime();
+		if (frustumCulling) {
+			staticBounds.cull(camera.getFrustumPlanes(), visibleStatic);
+		}
+		else {
+			visibleStatic.resize(staticBounds.getCount());
+			for (int i = 0; i < staticBounds.getCount(); i++) {
+				visibleStatic[i] = i;
+			}
+		}
+		occludedCount = 0;
+		if (occlusionCulling) {
+			//Nearest visible occluders first, by distance to their bounds' center
+			double occlusionStart = glfwGetTime();
+			occluderCandidates.clear();
+			for (int i : visibleStatic) {
+				if (staticObjects[i].occludes) {
+					glm::vec3 center = (staticBoundsMin[i] + staticBoundsMax[i]) * 0.5f;
+					occluderCandidates.push_back({ glm::dot(center - camera.getPosition(), center - camera.getPosition()), i });
+				}
+			}
+			int numOccluders = std::min((int)occluderCandidates.size(), MAX_OCCLUDERS);
+			std::partial_sort(occluderCandidates.begin(), occluderCandidates.begin() + numOccluders, occluderCandidates.end());
+			occlusionCuller.beginFrame(cameraViewProjection);
+			for (int i = 0; i < numOccluders; i++) {
+				int occluderId = occluderCandidates[i].second;
+				const StaticObject& occluder = staticObjects[occluderId];
+				occlusionCuller.addOccluder(occluder.meshData, staticTransforms.getWorldMatrix(occluder.transform), occluderId);
+			}
+			occlusionCuller.rasterize();
+			int numVisible = (int)visibleStatic.size();
+			occlusionCuller.removeOccluded(staticBoundsMin.data(), staticBoundsMax.data(), visibleStatic);
+			occludedCount = numVisible - (int)visibleStatic.size();
+			occlusionMs = (float)((glfwGetTime() - occlusionStart) * 1000.0);
+		}
+
+		//Receivers are whatever the camera sees, in light view space. Anything outside the camera contributes nothing
+		glm::vec3 receiverMin = glm::vec3(FLT_MAX);
+		glm::vec3 receiverMax = glm::vec3(-FLT_MAX);
+		auto addReceiver = [&](const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+			glm::vec3 center = ew::transformPoint(lightView, (boundsMin + boundsMax) * 0.5f);
+			glm::vec3 halfSize = (boundsMax - boundsMin) * 0.5f;
+			glm::vec3 extents = glm::vec3(0);
+			for (int axis = 0; axis < 3; axis++) {
+				extents += glm::abs(glm::vec3(lightView[axis])) * halfSize[axis];
+			}
+			receiverMin = glm::min(receiverMin, center - extents);
+			receiverMax = glm::max(receiverMax, center + extents);
+		};
+		auto addReceiverIfVisible = [&](const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+			if (ew::isBoxVisible(camera.getFrustumPlanes(), boundsMin, boundsMax)) {
+				addReceiver(boundsMin, boundsMax);
+			}
+		};
+		for (int i : visibleStatic) {
+			addReceiver(staticBatch->getRanges()[i].boundsMin, staticBatch->getRanges()[i].boundsMax);
+		}
+		if (curvedShapeMode != CURVED_SHAPES_MESH) {
+			addReceiverIfVisible(sphereTransform.position - glm::vec3(0.5f), sphereTransform.position + glm::vec3(0.5f));
+			addReceiverIfVisible(cylinderTransform.position - glm::vec3(0.5f), cylinderTransform.position + glm::vec3(0.5f));
+		}
+		if (showGpuShape) {
+			addReceiverIfVisible(gpuShapeTransform.position - glm::vec3(0.5f), gpuShapeTransform.position + glm::vec3(0.5f));
+		}
+		//Whole character grid, padded for the sway
+		int charactersPerRow = (int)ceil(sqrt((float)characterCount));
+		float charactersOffset = (charactersPerRow - 1) * CHARACTER_SPACING * 0.5f + 0.5f;
+		float characterRows = (float)((characterCount + charactersPerRow - 1) / charactersPerRow);
+		glm::vec3 charactersMin = glm::vec3(-charactersOffset, planeTransform.position.y, -4.5f - characterRows * CHARACTER_SPACING);
+		glm::vec3 charactersMax = glm::vec3(charactersOffset, planeTransform.position.y + 2.5f, -3.5f);
+		if (showCharacters) {
+			addReceiverIfVisible(charactersMin, charactersMax);
+		}
+		if (impostorSphereCount > 0) {
+			float sphereOffset = ((int)ceil(sqrt((float)impostorSphereCount)) - 1) * 0.5f + 0.4f;
+			addReceiverIfVisible(glm::vec3(-sphereOffset, 2.6f, -sphereOffset), glm::vec3(sphereOffset, 3.4f, sphereOffset));
+		}
+		//Terrain is everywhere, so it's everything the shadow map covers
+		if (showTerrain) {
+			receiverMin = glm::vec3(-FLT_MAX);
+			receiverMax = glm::vec3(FLT_MAX);
+		}
+		receiverMin = glm::max(receiverMin, glm::vec3(-10.0f, -10.0f, -farPlane));
+		receiverMax = glm::min(receiverMax, glm::vec3(10.0f, 10.0f, -nearPlane));
+
+		visibleCasters.clear();
+		if (!shadowCasterCulling) {
+			for (int i = 0; i < (int)staticObjects.size(); i++) {
+				visibleCasters.push_back(i);
+			}
+		}
+		else if (receiverMin.x <= receiverMax.x && receiverMin.y <= receiverMax.y && receiverMin.z <= receiverMax.z) {
+			staticBounds.cull(ew::extractShadowCasterPlanes(lightView, receiverMin, receiverMax), visibleCasters);
+		}
+		int numCasters = 0;
+		for (int i : visibleCasters) {
+			if (staticObjects[i].castsShadow) {
+				visibleCasters[numCasters++] = i;
+			}
+		}
+		visibleCasters.resize(numCasters);
+		cullMs = (float)((glfwGetTime() - cullStart) * 1000.0);
+
+		if (builtLocalLightCount != localLightCount || builtLocalLightRange != localLightRange) {
+			//Same layout every time: a low discrepancy scatter, every fourth light a spot pointing down
+			std::vector<ew::LocalLight> localLights(localLightCount);
+			for (int i = 0; i < localLightCount; i++) {
+				ew::LocalLight& light = localLights[i];
+				glm::vec2 scatter = glm::fract(glm::vec2(0.5f) + (float)i * glm::vec2(0.7548777f, 0.5698403f));
+				light.position = glm::vec3((scatter.x - 0.5f) * LOCAL_LIGHT_AREA, 0.5f + (i % 3) * 0.5f, (scatter.y - 0.5f) * LOCAL_LIGHT_AREA);
+				light.range = localLightRange;
+				light.color = glm::abs(glm::sin(glm::vec3(0.0f, 2.1f, 4.2f) + (float)i));
+				light.intensity = 2.0f;
+				light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+				light.cosOuterAngle = i % 4 == 3 ? cos(glm::radians(35.0f)) : -2.0f;
+				light.cosInnerAngle = i % 4 == 3 ? cos(glm::radians(25.0f)) : -1.0f;
+			}
+			lightLists.setLights(localLights);
+			builtLocalLightCount = localLightCount;
+			builtLocalLightRange = localLightRange;
+		}
+		if (localLightCount > 0) {
+			double lightListStart = glfwGetTime();
+			lightLists.assign(staticBoundsMin.data(), staticBoundsMax.data(), visibleStatic.data(), (int)visibleStatic.size(), camera.getFrustumPlanes());
+			lightListMs = (float)((glfwGetTime() - lightListStart) * 1000.0);
+		}
+
+		//Skin once, the shadow and lit passes below both draw the same skinned vertices
+		if (showCharacters) {
+			double paletteStart = glfwGetTime();
+			float characterOffset = (charactersPerRow - 1) * CHARACTER_SPACING * 0.5f;
+			characterPalettes.resize(characterCount * CHARACTER_JOINTS);
+			ew::parallelFor(characterCount, 64, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					glm::vec3 position = glm::vec3((i % charactersPerRow) * CHARACTER_SPACING - characterOffset, planeTransform.position.y, -4.0f - (i / charactersPerRow) * CHARACTER_SPACING);
+					characterPlayers[i].advance(deltaTime);
+					characterSkeleton.computePalette(swayClip, characterPlayers[i].sample().data(), glm::translate(glm::mat4(1), position), &characterPalettes[i * CHARACTER_JOINTS]);
+				}
+			});
+			characters.setPalettes(characterPalettes, dualQuaternionSkinning);
+			characterPaletteMs = (float)((glfwGetTime() - paletteStart) * 1000.0);
+
+			glBeginQuery(GL_TIME_ELAPSED, skinningQueries[skinningQueryFrame & 1]);
+			characters.skin(skinningShader);
+			glEndQuery(GL_TIME_ELAPSED);
+			if (skinningQueryFrame > 0) {
+				GLuint64 elapsed;
+				glGetQueryObjectui64v(skinningQueries[(skinningQueryFrame - 1) & 1], GL_QUERY_RESULT, &elapsed);
+				skinningMs = elapsed / 1000000.0f;
+			}
+			skinningQueryFrame++;
+		}
+
+		//Tessellation levels always come from the main camera, so the shadow pass refines exactly like the lit pass
+		auto drawTessellated = [&](Shader& shader, const glm::mat4& viewProjection) {
+			shader.use();
+			shader.setMat4("_ViewProjection", viewProjection);
+			shader.setMat4("_LightMatrix", lightMatrix);
+			shader.setVec3("_TessCameraPos", camera.getPosition());
+			shader.setFloat("_TessPixelsPerUnit", SCREEN_HEIGHT * 0.5f * camera.getProjectionMatrix()[1][1]);
+			shader.setFloat("_TessTargetEdgePixels", tessTargetEdgePixels);
+			shader.setFloat("_TessMaxLevel", tessMaxLevel);
+
+			shader.setInt("_Shape", 0);
+			shader.setMat4("_Model", sphereTransform.getModelMatrix());
+			shader.setMat3("_NormalMatrix", sphereTransform.getNormalMatrix());
+			sphereControlMesh.drawPatches();
+			shader.setInt("_Shape", 1);
+			shader.setMat4("_Model", cylinderTransform.getModelMatrix());
+			shader.setMat3("_NormalMatrix", cylinderTransform.getNormalMatrix());
+			cylinderControlMesh.drawPatches();
+			drawCount += 2;
+		};
+
+		auto drawImpostors = [&](Shader& shader, const glm::mat4& viewProjection, const glm::mat4& inverseViewProjection, bool culled) {
+			shader.use();
+			shader.setMat4("_ViewProjection", viewProjection);
+			shader.setMat4("_InverseViewProjection", inverseViewProjection);
+			shader.setVec2("_ViewportSize", glm::vec2(SCREEN_WIDTH, SCREEN_HEIGHT));
+			shader.setMat4("_LightMatrix", lightMatrix);
+			shader.setInt("_Shape", 0);
+			culled ? sphereImpostors.drawCulled() : sphereImpostors.draw();
+			shader.setInt("_Shape", 1);
+			culled ? cylinderImpostors.drawCulled() : cylinderImpostors.draw();
+			drawCount += 2;
+		};
 
 		//render objects for shadowmap, using depth shader.
 		depthShader.use();
 		depthShader.setMat4("_LightMatrix", lightMatrix);
-
-		//I could probably make this a function. Good thing I am not graded on code efficency! 
-		depthShader.setMat4("_Model", cubeTransform.getModelMatrix());
-		cubeMesh.draw();
-		depthShader.setMat4("_Model", sphereTransform.getModelMatrix());
-		sphereMesh.draw();
-		depthShader.setMat4("_Model", cylinderTransform.getModelMatrix());
-		cylinderMesh.draw();
-		depthShader.setMat4("_Model", planeTransform.getModelMatrix());
-		planeMesh.draw();
+		//Casters behind the light's near plane are flattened onto it instead of clipped
+		glEnable(GL_DEPTH_CLAMP);
+
+		int shadowDrawCount = 0;
+		int shadowTriangleCount = 0;
+		if (useStaticBatching) {
+			depthShader.setMat4("_Model", glm::mat4(1));
+			staticBatch->draw(visibleCasters);
+			shadowDrawCount += staticBatch->getLastDrawCount();
+			shadowTriangleCount += staticBatch->getLastTriangleCount();
+		}
+		else {
+			for (int i : visibleCasters) {
+				StaticObject& staticObject = staticObjects[i];
+				depthShader.setMat4("_Model", staticTransforms.getWorldMatrix(staticObject.transform));
+				staticObject.mesh->draw();
+				shadowDrawCount++;
+				shadowTriangleCount += (int)staticObject.meshData.numIndices / 3;
+			}
+		}
+		drawCount += shadowDrawCount;
+		if (showTerrain) {
+			depthShader.setMat4("_Model", glm::mat4(1));
+			terrain->draw();
+		}
+		if (showGpuShape) {
+			depthShader.setMat4("_Model", gpuShapeTransform.getModelMatrix());
+			gpuShapeMesh.draw();
+		}
+		if (showCharacters) {
+			depthShader.setMat4("_Model", glm::mat4(1));
+			characters.draw();
+			drawCount++;
+		}
+		if (curvedShapeMode == CURVED_SHAPES_TESSELLATED) {
+			drawTessellated(tessDepthShader, lightMatrix);
+		}
+		drawImpostors(impostorDepthShader, lightMatrix, inverseLightMatrix, false);
+		//Culled after the shadow pass so the GPU has something else to work on meanwhile
+		if (gpuImpostorCulling) {
+			sphereImpostors.cull(&impostorCullShader, camera.getFrustumPlanes());
+			cylinderImpostors.cull(&impostorCullShader, camera.getFrustumPlanes());
+		}
+		glDisable(GL_DEPTH_CLAMP);
 
 
 		//get that buffer!
@@ -268,59 +816,209 @@ int main() {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		//Now we draw
-		litShader.use();
-
-		litShader.setFloat("_Time", time);
-		litShader.setMat4("_Projection", camera.getProjectionMatrix());
-		litShader.setMat4("_View", camera.getViewMatrix());
-
-		//directional light
-		litShader.setVec3("_DirectionalLight.direction", glm::normalize(directionLight.direction));
-		litShader.setVec3("_DirectionalLight.color", directionLight.color);
-		litShader.setFloat("_DirectionalLight.intensity", directionLight.intensity);
-		litShader.setVec3("_LightPosition", lightPosition);
-		litShader.setMat4("_LightMatrix", lightMatrix);
+		//Both lit programs use defaultLit.frag, so they need the same uniforms
+		auto setLitUniforms = [&](Shader& shader) {
+			shader.setFloat("_Time", time);
+			shader.setMat4("_Projection", camera.getProjectionMatrix());
+			shader.setMat4("_View", camera.getViewMatrix());
+
+			//directional light
+			shader.setVec3("_DirectionalLight.direction", glm::normalize(directionLight.direction));
+			shader.setVec3("_DirectionalLight.color", directionLight.color);
+			shader.setFloat("_DirectionalLight.intensity", directionLight.intensity);
+			shader.setVec3("_LightPosition", lightPosition);
+			shader.setMat4("_LightMatrix", lightMatrix);
+
+			//texture units
+			shader.setInt("_Texture1", 0);
+			shader.setInt("_ShadowMap", 1);
+
+			//view position
+			shader.setVec3("_ViewPos", camera.getPosition());
+
+			//biases
+			shader.setFloat("_MinBias", biasMin);
+			shader.setFloat("_MaxBias", biasMax);
+
+			//Materials
+			shader.setVec3("_Material.color", mat.color);
+			shader.setFloat("_Material.ambientK", mat.ambientK);
+			shader.setFloat("_Material.diffuseK", mat.diffuseK);
+			shader.setFloat("_Material.specularK", mat.specularK);
+			shader.setFloat("_Material.shininess", mat.shininess);
+		};
+		setLitUniforms(litShader);
+		setLitUniforms(tessLitShader);
+		setLitUniforms(impostorLitShader);
+		lightLists.bind();
+		//Local lights of one static object, from its light list key
+		//Only the lit shader reads object lights
+		auto setObjectLights = [&](uint64_t key) {
+			int lights[ew::LightLists::MAX_LIGHTS_PER_OBJECT];
+			int numLights = 0;
+			for (int slot = 0; slot < ew::LightLists::MAX_LIGHTS_PER_OBJECT; slot++) {
+				int light = ew::LightLists::getKeyLight(key, slot);
+				if (light >= 0) {
+					lights[numLights++] = light;
+				}
+			}
+			if (numLights > 0) {
+				litShader.setIntArray(objectLightsLocation, lights, numLights);
+			}
+			litShader.setInt(numObjectLightsLocation, numLights);
+		};
+		auto getObjectLightKey = [&](int object) {
+			return localLightCount > 0 ? lightLists.getKey(object) : ew::LightLists::EMPTY_KEY;
+		};
 
 		//textures
 		glActiveTexture(GL_TEXTURE0);
-		litShader.setInt("_Texture1", 0);
 		glActiveTexture(GL_TEXTURE2);
 		glBindTexture(GL_TEXTURE_2D, frameBuffer);
-		litShader.setInt("_ShadowMap", 1);
-
-
-
-		//view position
-		litShader.setVec3("_ViewPos", camera.getPosition());
-		
-		//biases
-		litShader.setFloat("_MinBias", biasMin);
-		litShader.setFloat("_MaxBias", biasMax);
-
-		//Materials
-		litShader.setVec3("_Material.color", mat.color);
-		litShader.setFloat("_Material.ambientK", mat.ambientK);
-		litShader.setFloat("_Material.diffuseK", mat.diffuseK);
-		litShader.setFloat("_Material.specularK", mat.specularK);
-		litShader.setFloat("_Material.shininess", mat.shininess);
-
-
-
-		//Draw cube
-		litShader.setMat4("_Model", cubeTransform.getModelMatrix());
-		cubeMesh.draw();
-
-		//Draw sphere
-		litShader.setMat4("_Model", sphereTransform.getModelMatrix());
-		sphereMesh.draw();
-
-		//Draw cylinder
-		litShader.setMat4("_Model", cylinderTransform.getModelMatrix());
-		cylinderMesh.draw();
-
-		//Draw plane
-		litShader.setMat4("_Model", planeTransform.getModelMatrix());
-		planeMesh.draw();
+		litShader.use();
+		glBeginQuery(GL_TIME_ELAPSED, litPassQueries[litPassQueryFrame & 1]);
+
+
+		//Draw cube, sphere, cylinder, plane and props. Heavy ones are held back for the occlusion queries
+		litStatic.clear();
+		queriedStatic.clear();
+		for (int i : visibleStatic) {
+			if (gpuOcclusionQueries && ew::OcclusionQueries::isWorthQuerying((int)staticObjects[i].meshData.numIndices / 3)) {
+				queriedStatic.push_back(i);
+			}
+			else {
+				litStatic.push_back(i);
+			}
+		}
+		if (useStaticBatching) {
+			litShader.setMat4("_Model", glm::mat4(1));
+			litShader.setMat3("_NormalMatrix", glm::mat3(1));
+			if (localLightCount > 0) {
+				//Neighbours only merge if they have the same lights
+				staticBatch->draw(litStatic, lightLists.getKeys(), [&](uint64_t key) { setObjectLights(key); });
+			}
+			else {
+				staticBatch->draw(litStatic);
+			}
+			drawCount += staticBatch->getLastDrawCount();
+		}
+		//Unbatched static objects and the light gizmo go through the render queue, which groups them by program,
+		//texture and mesh and draws each group front to back
+		renderQueue.clear();
+		int litProgram = renderQueue.getResourceId(&litShader);
+		int unlitProgram = renderQueue.getResourceId(&unlitShader);
+		int rockMaterial = renderQueue.getResourceId(&textureRock);
+		auto getQueueDepth = [&](const glm::vec3& position) {
+			return glm::dot(position - camera.getPosition(), camera.getForward()) / RENDER_QUEUE_DEPTH_RANGE;
+		};
+		if (!useStaticBatching) {
+			for (int i : litStatic) {
+				StaticObject& staticObject = staticObjects[i];
+				float depth = getQueueDepth((staticBoundsMin[i] + staticBoundsMax[i]) * 0.5f);
+				uint64_t key = ew::RenderQueue::makeKey(RENDER_PASS_LIT, litProgram, rockMaterial, renderQueue.getResourceId(staticObject.mesh), depth);
+				renderQueue.submit(key, { &litShader, staticObject.mesh, textureRock, i });
+			}
+		}
+		//Gizmo parts are negative objects: -1 the bulb, -2 the arrow
+		if (showLightGizmo) {
+			sceneGraph.setLocalPosition(lightNode, lightPosition);
+			sceneGraph.setLocalRotation(lightNode, glm::quatLookAt(glm::normalize(directionLight.direction), glm::vec3(0, 1, 0)));
+			sceneGraph.update();
+			unlitShader.setMat4("_Projection", camera.getProjectionMatrix());
+			unlitShader.setMat4("_View", camera.getViewMatrix());
+			unlitShader.setVec3("_Color", directionLight.color);
+			float depth = getQueueDepth(lightPosition);
+			renderQueue.submit(ew::RenderQueue::makeKey(RENDER_PASS_UNLIT, unlitProgram, 0, renderQueue.getResourceId(sphereMesh.get()), depth), { &unlitShader, sphereMesh.get(), 0, -1 });
+			renderQueue.submit(ew::RenderQueue::makeKey(RENDER_PASS_UNLIT, unlitProgram, 0, renderQueue.getResourceId(cylinderMesh.get()), depth), { &unlitShader, cylinderMesh.get(), 0, -2 });
+		}
+		double renderQueueSortStart = glfwGetTime();
+		renderQueue.sort();
+		renderQueueSortMs = (float)((glfwGetTime() - renderQueueSortStart) * 1000.0);
+		glActiveTexture(GL_TEXTURE0);
+		renderQueue.execute([&](const ew::DrawPacket& packet) {
+			if (packet.object >= 0) {
+				const StaticObject& staticObject = staticObjects[packet.object];
+				setObjectLights(getObjectLightKey(packet.object));
+				litShader.setMat4("_Model", staticTransforms.getWorldMatrix(staticObject.transform));
+				litShader.setMat3("_NormalMatrix", staticTransforms.getNormalMatrix(staticObject.transform));
+			}
+			else {
+				unlitShader.setMat4("_Model", sceneGraph.getWorldMatrix(packet.object == -1 ? lightBulbNode : lightArrowNode));
+			}
+		});
+		drawCount += renderQueue.getPacketCount();
+		litShader.use();
+		//Only static objects have light lists
+		setObjectLights(ew::LightLists::EMPTY_KEY);
+		if (showTerrain) {
+			litShader.setMat4("_Model", glm::mat4(1));
+			litShader.setMat3("_NormalMatrix", glm::mat3(1));
+			terrain->draw();
+			drawCount += terrain->getDrawnChunkCount();
+		}
+		if (showGpuShape) {
+			litShader.setMat4("_Model", gpuShapeTransform.getModelMatrix());
+			litShader.setMat3("_NormalMatrix", gpuShapeTransform.getNormalMatrix());
+			gpuShapeMesh.draw();
+			drawCount++;
+		}
+		if (gpuOcclusionQueries) {
+			//Boxes are drawn with the depth program, taking the camera's matrix for the rest of the frame
+			depthShader.use();
+			depthShader.setMat4("_LightMatrix", cameraViewProjection);
+			occlusionQueries.beginFrame(&depthShader, cameraViewProjection);
+			for (int i : queriedStatic) {
+				StaticObject& staticObject = staticObjects[i];
+				bool conditional = occlusionQueries.beginConditional(i, staticBoundsMin[i], staticBoundsMax[i], litShader);
+				setObjectLights(getObjectLightKey(i));
+				litShader.setMat4("_Model", staticTransforms.getWorldMatrix(staticObject.transform));
+				litShader.setMat3("_NormalMatrix", staticTransforms.getNormalMatrix(staticObject.transform));
+				staticObject.mesh->draw();
+				drawCount++;
+				if (conditional) {
+					occlusionQueries.endConditional();
+				}
+			}
+			setObjectLights(ew::LightLists::EMPTY_KEY);
+			litShader.use();
+		}
+		if (showCharacters) {
+			//One draw for all of them, so one query for the whole grid, with an id after the static objects'
+			int characterTriangles = characterCount * (int)characterMeshData.indices.size() / 3;
+			bool conditional = gpuOcclusionQueries && ew::OcclusionQueries::isWorthQuerying(characterTriangles)
+				&& occlusionQueries.beginConditional((int)staticObjects.size(), charactersMin, charactersMax, litShader);
+			litShader.setMat4("_Model", glm::mat4(1));
+			litShader.setMat3("_NormalMatrix", glm::mat3(1));
+			characters.draw();
+			drawCount++;
+			if (conditional) {
+				occlusionQueries.endConditional();
+			}
+		}
+		if (curvedShapeMode == CURVED_SHAPES_TESSELLATED) {
+			drawTessellated(tessLitShader, cameraViewProjection);
+		}
+		drawImpostors(impostorLitShader, cameraViewProjection, camera.getInverseViewProjectionMatrix(), gpuImpostorCulling);
+
+		if (pickedObject >= 0) {
+			StaticObject& picked = staticObjects[pickedObject];
+			unlitShader.use();
+			unlitShader.setMat4("_Projection", camera.getProjectionMatrix());
+			unlitShader.setMat4("_View", camera.getViewMatrix());
+			unlitShader.setVec3("_Color", glm::vec3(1.0f, 1.0f, 0.0f));
+			unlitShader.setMat4("_Model", staticTransforms.getWorldMatrix(picked.transform));
+			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+			picked.mesh->draw();
+			glPolygonMode(GL_FRONT_AND_BACK, wireFrame ? GL_LINE : GL_FILL);
+			drawCount++;
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+		if (litPassQueryFrame > 0) {
+			GLuint64 elapsed;
+			glGetQueryObjectui64v(litPassQueries[(litPassQueryFrame - 1) & 1], GL_QUERY_RESULT, &elapsed);
+			litPassMs = elapsed / 1000000.0f;
+		}
+		litPassQueryFrame++;
 
 		//Draw UI
 		ImGui::Begin("Settings");
@@ -335,11 +1033,119 @@ int main() {
 		ImGui::SliderFloat("Max Bias", &biasMax, 0.01f, 0.1f);
 		ImGui::End();
 
+		ImGui::Begin("Static Batching");
+		ImGui::Checkbox("Enabled", &useStaticBatching);
+		ImGui::SliderInt("Static Props", &staticPropCount, 0, MAX_STATIC_PROPS);
+		ImGui::Text("Static objects: %d", (int)staticObjects.size());
+		ImGui::Text("Batch triangles: %d", staticBatch->getNumTriangles());
+		ImGui::Text("Draw calls: %d", drawCount);
+		ImGui::Checkbox("Frustum culling", &frustumCulling);
+		ImGui::Text("Visible: %d Culled: %d (%.3f ms)", (int)visibleStatic.size(), staticBounds.getCount() - (int)visibleStatic.size(), cullMs);
+		ImGui::Checkbox("Shadow caster culling", &shadowCasterCulling);
+		ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+		ImGui::SameLine();
+		ImGui::Checkbox("Occluder wall", &showOccluderWall);
+		ImGui::Checkbox("GPU occlusion queries", &gpuOcclusionQueries);
+		if (gpuOcclusionQueries) {
+			ImGui::Text("Queries: %d (%d+ triangles) Occluded last frame: %d of %d resolved", occlusionQueries.getQueryCount(),
+				ew::OcclusionQueries::MIN_QUERY_TRIANGLES, occlusionQueries.getLastOccludedCount(), occlusionQueries.getLastResolvedCount());
+		}
+		if (occlusionCulling) {
+			int occlusionTested = (int)visibleStatic.size() + occludedCount;
+			ImGui::Text("Occluders: %d (%d triangles) Occluded: %d (%.1f%%, %.3f ms)", occlusionCuller.getOccluderCount(), occlusionCuller.getRasterizedTriangleCount(),
+				occludedCount, occlusionTested > 0 ? 100.0f * occludedCount / occlusionTested : 0.0f, occlusionMs);
+		}
+		ImGui::Text("BVH nodes: %d SAH cost: %.1f", staticBvh.getNodeCount(), staticBvh.getSahCost());
+		ImGui::Text("Picked: %d (%.3f ms)", pickedObject, pickMs);
+		ImGui::Text("Shadow casters: %d Draws: %d Triangles: %d", (int)visibleCasters.size(), shadowDrawCount, shadowTriangleCount);
+		ImGui::Text("Lit pass GPU time: %.3f ms", litPassMs);
+		ImGui::Text("Mesh cache: %d entries, %d hits, %d misses", meshCache.getEntryCount(), meshCache.getHitCount(), meshCache.getMissCount());
+		ImGui::End();
+
+		ImGui::Begin("Terrain");
+		ImGui::Checkbox("Show", &showTerrain);
+		ImGui::Checkbox("GPU generation", &gpuTerrain);
+		if (terrain) {
+			ImGui::Text("Resident chunks: %d", terrain->getResidentChunkCount());
+			ImGui::Text("Pending chunks: %d", terrain->getPendingChunkCount());
+			ImGui::Text("Drawn chunks: %d", terrain->getDrawnChunkCount());
+			ImGui::Text("Triangles: %d", terrain->getDrawnTriangleCount());
+			ImGui::Text("LOD bias: %d", terrain->getLodBias());
+			ImGui::Text("GPU memory: %.1f MB", terrain->getGpuMemoryBytes() / (1024.0f * 1024.0f));
+		}
+		ImGui::End();
+
+		ImGui::Begin("GPU ShapeGen");
+		ImGui::Checkbox("Show", &showGpuShape);
+		ImGui::RadioButton("Sphere", &gpuShapeType, 0); ImGui::SameLine();
+		ImGui::RadioButton("Cylinder", &gpuShapeType, 1); ImGui::SameLine();
+		ImGui::RadioButton("Plane", &gpuShapeType, 2);
+		ImGui::SliderInt("Segments", &gpuShapeSegments, 3, 256);
+		ImGui::Text("Vertices: %d Indices: %d", gpuShapeMesh.getNumVertices(), gpuShapeMesh.getNumIndices());
+		//Reads the GPU buffers back and diffs them against the CPU generator
+		if (ImGui::Button("Compare with CPU") && builtGpuShapeType >= 0) {
+			ew::MeshData reference;
+			switch (builtGpuShapeType)
+			{
+			case 0: ew::createSphere(0.5f, builtGpuShapeSegments, reference); break;
+			case 1: ew::createCylinder(1.0f, 0.5f, builtGpuShapeSegments, reference); break;
+			case 2: ew::createPlane(1.0f, 1.0f, reference); break;
+			}
+			gpuShapeDifference = gpuShapeMesh.compareTo(reference);
+			gpuShapeCompared = true;
+		}
+		if (gpuShapeCompared) {
+			if (gpuShapeDifference < 0.0f) {
+				ImGui::Text("Mismatch: counts or indices differ");
+			}
+			else {
+				ImGui::Text("Max vertex difference: %g", gpuShapeDifference);
+			}
+		}
+		ImGui::End();
+
+		ImGui::Begin("Skinning");
+		ImGui::Checkbox("Show", &showCharacters);
+		ImGui::Checkbox("Dual quaternion", &dualQuaternionSkinning);
+		ImGui::SliderInt("Characters", &characterCount, 1, MAX_CHARACTERS);
+		ImGui::Text("Skinned vertices: %d", characters.getSkinnedVertexCount());
+		ImGui::Text("Palette CPU time: %.3f ms", characterPaletteMs);
+		ImGui::Text("Skinning GPU time: %.3f ms", skinningMs);
+		ImGui::End();
+
+		ImGui::Begin("Render Queue");
+		ImGui::Text("Packets: %d (static objects when batching is off, light gizmo)", renderQueue.getPacketCount());
+		ImGui::Text("Program/VAO/texture switches");
+		ImGui::Text("Submission order: %d/%d/%d", renderQueue.getSubmittedSwitches().x, renderQueue.getSubmittedSwitches().y, renderQueue.getSubmittedSwitches().z);
+		ImGui::Text("Sorted: %d/%d/%d (sort %.3f ms)", renderQueue.getExecutedSwitches().x, renderQueue.getExecutedSwitches().y, renderQueue.getExecutedSwitches().z, renderQueueSortMs);
+		ImGui::End();
+
+		ImGui::Begin("Local Lights");
+		ImGui::SliderInt("Count", &localLightCount, 0, ew::LightLists::MAX_LIGHTS);
+		ImGui::SliderFloat("Range", &localLightRange, 0.5f, 10.0f);
+		if (localLightCount > 0) {
+			ImGui::Text("In frustum: %d Lights per object: %.2f (max %d)", lightLists.getVisibleLightCount(),
+				visibleStatic.empty() ? 0.0f : (float)lightLists.getLastAssignedCount() / visibleStatic.size(), ew::LightLists::MAX_LIGHTS_PER_OBJECT);
+			ImGui::Text("Light lists CPU time: %.3f ms", lightListMs);
+		}
+		ImGui::End();
+
+		ImGui::Begin("Curved Shapes");
+		ImGui::RadioButton("Mesh", &curvedShapeMode, CURVED_SHAPES_MESH);
+		ImGui::RadioButton("Tessellated", &curvedShapeMode, CURVED_SHAPES_TESSELLATED);
+		ImGui::RadioButton("Impostor", &curvedShapeMode, CURVED_SHAPES_IMPOSTOR);
+		ImGui::SliderFloat("Target Edge Pixels", &tessTargetEdgePixels, 2.0f, 64.0f);
+		ImGui::SliderFloat("Max Tessellation Level", &tessMaxLevel, 1.0f, 64.0f);
+		ImGui::SliderInt("Impostor Spheres", &impostorSphereCount, 0, MAX_IMPOSTOR_SPHERES);
+		ImGui::Checkbox("GPU impostor culling", &gpuImpostorCulling);
+		ImGui::End();
+
 		ImGui::Begin("Directional Settings");
 		ImGui::SliderFloat("Directional Light Intensity", &directionLight.intensity, 0, 5);
 		ImGui::ColorEdit3("Directional Light Color", &directionLight.color.r);
 		ImGui::DragFloat3("Directional Light Direction", &directionLight.direction.x);
 		ImGui::SliderFloat("Directional Light Distance", &lightDist, 1, 25);
+		ImGui::Checkbox("Show Light Gizmo", &showLightGizmo);
 
 		lightPosition = glm::normalize(-directionLight.direction) * lightDist;
 
@@ -353,6 +1159,10 @@ int main() {
 
 		glfwSwapBuffers(window);
 	}
+	delete staticBatch;
+	delete terrain;
+	glDeleteQueries(2, litPassQueries);
+	glDeleteQueries(2, skinningQueries);
 	glDeleteTextures(1, &shadowMapTex);
 	glDeleteFramebuffers(1, &frameBuffer);
 	glfwTerminate();
@@ -420,6 +1230,12 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 		glfwSetInputMode(window, GLFW_CURSOR, inputMode);
 		glfwGetCursorPos(window, &prevMouseX, &prevMouseY);
 	}
+	//Picking, unless the click was on the UI
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && glfwGetInputMode(window, GLFW_CURSOR) != GLFW_CURSOR_DISABLED
+		&& !ImGui::GetIO().WantCaptureMouse) {
+		glfwGetCursorPos(window, &pickX, &pickY);
+		pickRequested = true;
+	}
 }
 
 //Author: Eric Winebrenner
@@ -0,0 +1,26 @@
+#version 450
+out vec4 FragColor;
+
+//Filled in from the ray hit, then shaded by the same code as defaultLit.frag
+vec3 WorldPos;
+vec3 WorldNormal;
+vec3 normal;
+vec2 uv;
+vec4 LightSpaceFragPosition;
+
+out vec4 color;
+
+uniform mat4 _LightMatrix;
+
+#include "impostor.glsl"
+#include "lighting.glsl"
+
+void main()
+{
+    ImpostorHit hit = castImpostorRay();
+    getImpostorSurface(hit.objectPos, normal, uv);
+    WorldPos = hit.worldPos;
+    WorldNormal = transpose(mat3(InverseModel)) * normal;
+    LightSpaceFragPosition = _LightMatrix * vec4(WorldPos, 1);
+    color = shadeSurface();
+}
@@ -0,0 +1,99 @@
+//Ray casting for impostor.vert. Shapes are the ShapeGen defaults in object space:
+//sphere of radius 0.5, cylinder along Y with height 1 and radius 0.5
+
+in vec3 BoxPos;
+flat in mat4 InverseModel;
+
+uniform mat4 _ViewProjection;
+uniform mat4 _InverseViewProjection;
+uniform vec2 _ViewportSize;
+//0 = sphere, 1 = capped cylinder
+uniform int _Shape;
+
+//Back faces of the box are drawn, so the real surface is always in front of them
+layout (depth_less) out float gl_FragDepth;
+
+const float PI = 3.14159265359;
+const float NO_HIT = 1e20;
+
+//Smallest t > 0 where ro + rd * t hits the shape, NO_HIT if it misses
+float intersectSphere(vec3 ro, vec3 rd){
+    float a = dot(rd, rd);
+    float b = dot(ro, rd);
+    float c = dot(ro, ro) - 0.25;
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0) return NO_HIT;
+    float root = sqrt(discriminant);
+    float t = (-b - root) / a;
+    if (t < 0.0) t = (-b + root) / a;
+    return t < 0.0 ? NO_HIT : t;
+}
+
+float intersectCylinder(vec3 ro, vec3 rd){
+    float hit = NO_HIT;
+    float a = dot(rd.xz, rd.xz);
+    float b = dot(ro.xz, rd.xz);
+    float c = dot(ro.xz, ro.xz) - 0.25;
+    float discriminant = b * b - a * c;
+    if (a > 0.0 && discriminant >= 0.0){
+        float root = sqrt(discriminant);
+        float t0 = (-b - root) / a;
+        float t1 = (-b + root) / a;
+        if (t0 >= 0.0 && abs(ro.y + rd.y * t0) <= 0.5) hit = t0;
+        else if (t1 >= 0.0 && abs(ro.y + rd.y * t1) <= 0.5) hit = t1;
+    }
+    if (rd.y != 0.0){
+        for (int side = -1; side <= 1; side += 2){
+            float t = (side * 0.5 - ro.y) / rd.y;
+            vec2 p = ro.xz + rd.xz * t;
+            if (t >= 0.0 && t < hit && dot(p, p) <= 0.25) hit = t;
+        }
+    }
+    return hit;
+}
+
+struct ImpostorHit {
+    vec3 worldPos;
+    vec3 objectPos;
+};
+
+//Casts this pixel's ray against the instance's shape. Discards on a miss, otherwise writes gl_FragDepth
+ImpostorHit castImpostorRay(){
+    //Unproject the pixel at the near and far planes, works for perspective and orthographic
+    vec2 ndc = gl_FragCoord.xy / _ViewportSize * 2.0 - 1.0;
+    vec4 nearPoint = _InverseViewProjection * vec4(ndc, -1.0, 1.0);
+    vec4 farPoint = _InverseViewProjection * vec4(ndc, 1.0, 1.0);
+    vec3 worldOrigin = nearPoint.xyz / nearPoint.w;
+    vec3 worldDirection = farPoint.xyz / farPoint.w - worldOrigin;
+
+    //t is the same in world and object space since the model matrix is affine
+    vec3 ro = vec3(InverseModel * vec4(worldOrigin, 1));
+    vec3 rd = mat3(InverseModel) * worldDirection;
+    float t = _Shape == 0 ? intersectSphere(ro, rd) : intersectCylinder(ro, rd);
+    if (t == NO_HIT) discard;
+
+    ImpostorHit hit;
+    hit.objectPos = ro + rd * t;
+    hit.worldPos = worldOrigin + worldDirection * t;
+    vec4 clipPos = _ViewProjection * vec4(hit.worldPos, 1);
+    gl_FragDepth = clipPos.z / clipPos.w * 0.5 + 0.5;
+    return hit;
+}
+
+//Object space normal + UVs matching createSphere and createCylinder, so switching to impostors keeps the texture
+void getImpostorSurface(vec3 p, out vec3 n, out vec2 texCoord){
+    if (_Shape == 0){
+        n = normalize(p);
+        //Same as createSphere: U is theta / PI, 0 to 2 around Y starting at +Z. V is phi, 0 at the top pole to PI at the bottom
+        float theta = mod(atan(n.x, n.z), 2.0 * PI);
+        texCoord = vec2(theta / PI, acos(clamp(n.y, -1.0, 1.0)));
+    }
+    else if (abs(p.y) >= 0.5 - 1e-4 && dot(p.xz, p.xz) < 0.25 - 1e-4){
+        n = vec3(0, sign(p.y), 0);
+        texCoord = p.xz;
+    }
+    else{
+        n = normalize(vec3(p.x, 0, p.z));
+        texCoord = vec2(fract(atan(p.z, p.x) / (2.0 * PI)), p.y + 0.5);
+    }
+}
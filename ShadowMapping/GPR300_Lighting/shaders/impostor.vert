@@ -0,0 +1,17 @@
+#version 450
+layout (location = 0) in vec3 vPos;
+//Per instance model matrix and its inverse from the CPU, locations 4-7 and 8-11
+layout (location = 4) in mat4 vInstanceModel;
+layout (location = 8) in mat4 vInstanceInverseModel;
+
+uniform mat4 _ViewProjection;
+
+out vec3 BoxPos;
+flat out mat4 InverseModel;
+
+//Draws the bounding box of the unit shape, the fragment shader ray casts the real surface inside it
+void main(){
+    BoxPos = vPos;
+    InverseModel = vInstanceInverseModel;
+    gl_Position = _ViewProjection * vInstanceModel * vec4(vPos, 1);
+}
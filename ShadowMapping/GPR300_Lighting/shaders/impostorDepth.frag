@@ -0,0 +1,9 @@
+#version 450
+
+#include "impostor.glsl"
+
+//Only the depth of the ray hit matters for the shadow map
+void main()
+{
+    castImpostorRay();
+}
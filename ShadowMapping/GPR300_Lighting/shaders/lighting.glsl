@@ -0,0 +1,139 @@
+//Lighting + shadows shared by every lit fragment shader. The including shader provides
+//WorldPos, WorldNormal, normal, uv and LightSpaceFragPosition, as inputs or as globals it fills in
+
+uniform vec3 _ViewPos;
+uniform sampler2D _Texture1;
+uniform sampler2D _ShadowMap;
+
+uniform float _Time;
+
+uniform float _MinBias;
+uniform float _MaxBias;
+uniform vec3 _LightPosition;
+
+
+//Point or spot light with a bounded range, laid out like ew::LocalLight. Point lights have cone cosines of -2 and -1
+struct LocalLight
+{
+    vec3 position;
+    float range;
+    vec3 color;
+    float intensity;
+    vec3 direction;
+    float cosOuterAngle;
+    float cosInnerAngle;
+};
+
+struct DirectionalLight
+{
+    vec3 direction;
+    vec3 color;
+    float intensity;
+};
+
+struct Material
+{
+	vec3 color;
+	float ambientK;
+	float diffuseK;
+	float specularK;
+	float shininess;
+};
+
+
+float calculateShadow(float lightNormal)
+{
+    vec3 pos = LightSpaceFragPosition.xyz * 0.5f + 0.5f;
+    //clamp positive z position
+    if(pos.z > 1)
+    {
+        pos.z = 1;
+    }
+
+    float shadowBias = max(_MaxBias * (1.0 - lightNormal), _MinBias);
+
+    //blur dem shadows
+    //taken from https://learnopengl.com/Advanced-Lighting/Shadows/Shadow-Mapping
+    float shadow = 0.0 ,depth;
+    vec2 texelSize = 1.0 / textureSize(_ShadowMap, 0);
+
+    for (int x = -1; x <= 1; ++x)
+    {
+        for (int y = -1; y <= 1; ++y)
+        {
+            depth = texture(_ShadowMap, pos.xy + vec2(x, y) * texelSize).r;
+            shadow += (depth + shadowBias) < pos.z ? 0.0 : 1.0;
+        }
+    }
+
+    return shadow / 9.0;
+}
+
+//Every local light, from ew::LightLists. Each draw only shades the few picked for its object
+const int MAX_LOCAL_LIGHTS = 256;
+const int MAX_OBJECT_LIGHTS = 4;
+layout (std140, binding = 0) uniform LocalLights
+{
+    LocalLight _LocalLights[MAX_LOCAL_LIGHTS];
+};
+//Indices into _LocalLights, the first _NumObjectLights are used. 0 unless the draw sets them
+uniform int _NumObjectLights;
+uniform int _ObjectLights[MAX_OBJECT_LIGHTS];
+uniform DirectionalLight _DirectionalLight;
+uniform Material _Material;
+
+vec3 calculateDirectionalLight(DirectionalLight light)
+{
+    vec3 result = vec3(0);
+    vec3 normal = normalize(WorldNormal);
+    vec3 lightDir = -normalize(light.direction);
+    vec3 viewDir = normalize(_ViewPos - WorldPos);
+    vec3 halfway = normalize(lightDir + viewDir);
+
+    float diff = _Material.diffuseK * max(dot(normal, lightDir), 0.0);
+    float spec = _Material.specularK * pow(max(dot(normal, halfway), 0.0), _Material.shininess);
+    vec3 diffuse = diff * light.color * light.intensity;
+    vec3 specular = spec * light.color * light.intensity;
+    vec3 ambient = _Material.ambientK * light.intensity * light.color;
+    result = (ambient + diffuse + specular);    
+    return result;
+};
+
+//Inverse square, windowed to reach 0 at range. Same as ew::getLocalLightFalloff
+float localLightFalloff(float dist, float range)
+{
+    float ratio = dist / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / max(dist * dist, 0.01);
+}
+
+vec3 calculateLocalLight(LocalLight light)
+{
+    vec3 normal = normalize(WorldNormal);
+    vec3 toLight = light.position - WorldPos;
+    float dist = length(toLight);
+    vec3 lightDir = toLight / max(dist, 0.0001);
+    vec3 viewDir = normalize(_ViewPos - WorldPos);
+    vec3 halfway = normalize(lightDir + viewDir);
+    float attenuation = localLightFalloff(dist, light.range);
+    //Always 1 for point lights, their cone starts past straight behind
+    attenuation *= smoothstep(light.cosOuterAngle, light.cosInnerAngle, dot(-lightDir, light.direction));
+    float diff = _Material.diffuseK * max(dot(normal, lightDir), 0.0);
+    float spec = _Material.specularK * pow(max(dot(normal, halfway), 0.0), _Material.shininess);
+    return (diff + spec) * light.color * light.intensity * attenuation * _Material.color;
+}
+
+vec4 shadeSurface()
+{
+    vec3 result = vec3(0);
+    vec3 lightDirection = normalize(_LightPosition - WorldPos);
+    result += calculateDirectionalLight(_DirectionalLight);
+    float shadow = calculateShadow(dot(lightDirection, normal));
+    result *= shadow;
+    for (int i = 0; i < _NumObjectLights; i++)
+    {
+        result += calculateLocalLight(_LocalLights[_ObjectLights[i]]);
+    }
+    vec4 lerpedTex = texture(_Texture1, uv);
+    return vec4(result, 1.0) * lerpedTex;
+}
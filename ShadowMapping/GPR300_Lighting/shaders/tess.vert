@@ -0,0 +1,12 @@
+#version 450
+layout (location = 0) in vec3 vPos;
+layout (location = 1) in vec3 vNormal;
+
+out vec3 ControlPos;
+out vec3 ControlNormal;
+
+//Control points are passed through in model space, tess.tese does all the transforms
+void main(){
+    ControlPos = vPos;
+    ControlNormal = vNormal;
+}